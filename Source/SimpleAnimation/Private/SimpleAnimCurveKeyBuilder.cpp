@@ -0,0 +1,279 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimCurveKeyBuilder.h"
+
+#include "SimpleAnimStats.h"
+#include "Async/ParallelFor.h"
+
+namespace SimpleAnimCurveKeyBuilder
+{
+	/** Value between two keys, the same as FRichCurve::Eval() for keys without tangent weights, see IsWeighted() */
+	static float EvalSegment(const FRichCurveKey& Key1, const FRichCurveKey& Key2, float Time)
+	{
+		const float Diff = Key2.Time - Key1.Time;
+		if (Diff <= 0.f || Key1.InterpMode == RCIM_Constant)
+		{
+			return Key1.Value;
+		}
+
+		const float Alpha = (Time - Key1.Time) / Diff;
+		if (Key1.InterpMode != RCIM_Cubic)
+		{
+			return FMath::Lerp(Key1.Value, Key2.Value, Alpha);
+		}
+
+		// Bezier control points from the tangents
+		constexpr float OneThird = 1.f / 3.f;
+		const float P0 = Key1.Value;
+		const float P1 = P0 + Key1.LeaveTangent * Diff * OneThird;
+		const float P3 = Key2.Value;
+		const float P2 = P3 - Key2.ArriveTangent * Diff * OneThird;
+
+		const float InvAlpha = 1.f - Alpha;
+		return InvAlpha * InvAlpha * InvAlpha * P0 + 3.f * InvAlpha * InvAlpha * Alpha * P1 +
+			3.f * InvAlpha * Alpha * Alpha * P2 + Alpha * Alpha * Alpha * P3;
+	}
+
+	/** Weighted tangents aren't evaluated by EvalSegment(), so these keys are always kept and never span a removed key */
+	static bool IsWeighted(const FRichCurveKey& Key)
+	{
+		return Key.TangentWeightMode != RCTWM_WeightedNone;
+	}
+
+	/**
+	 * @return Furthest key a segment from Keys[First] can reach without removing a weighted key, a change of
+	 * interpolation mode, or ending on a weighted key. Only the newly reached key is checked at each step
+	 */
+	static int32 GetSegmentLimit(const TArray<FRichCurveKey>& Keys, int32 First)
+	{
+		const FRichCurveKey& FirstKey = Keys[First];
+		int32 Limit = First + 1;
+		if (IsWeighted(FirstKey))
+		{
+			return Limit;
+		}
+
+		while (Limit + 1 < Keys.Num())
+		{
+			const FRichCurveKey& Key = Keys[Limit];
+			if (Key.InterpMode != FirstKey.InterpMode || IsWeighted(Key) || IsWeighted(Keys[Limit + 1]))
+			{
+				break;
+			}
+			++Limit;
+		}
+		return Limit;
+	}
+
+	/** @return True if a single segment from Keys[First] to Keys[Last] stays within Tolerance of every key between them */
+	static bool CanReplaceSegment(const TArray<FRichCurveKey>& Keys, int32 First, int32 Last, float Tolerance)
+	{
+		const FRichCurveKey& FirstKey = Keys[First];
+		const FRichCurveKey& LastKey = Keys[Last];
+		for (int32 KeyIndex = First; KeyIndex < Last; ++KeyIndex)
+		{
+			const FRichCurveKey& Key = Keys[KeyIndex];
+			const FRichCurveKey& NextKey = Keys[KeyIndex + 1];
+
+			// The removed key itself
+			if (KeyIndex > First && FMath::Abs(EvalSegment(FirstKey, LastKey, Key.Time) - Key.Value) > Tolerance)
+			{
+				return false;
+			}
+
+			// Cubics can bulge between keys, so check the middle of each original segment too
+			const float MidTime = (Key.Time + NextKey.Time) * 0.5f;
+			if (FMath::Abs(EvalSegment(FirstKey, LastKey, MidTime) - EvalSegment(Key, NextKey, MidTime)) > Tolerance)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @return Furthest key up to Limit that a single segment from Keys[First] can reach within Tolerance
+	 * Doubles the segment until it fails, then binary searches back, so each key is checked O(log n) times instead of
+	 * once per key the segment grows by
+	 */
+	static int32 FindSegmentEnd(const TArray<FRichCurveKey>& Keys, int32 First, int32 Limit, float Tolerance)
+	{
+		int32 Reached = First + 1;
+		int32 Failed = Limit + 1;
+		for (int32 Step = 1; Reached < Limit; Step *= 2)
+		{
+			const int32 Candidate = FMath::Min(Reached + Step, Limit);
+			if (!CanReplaceSegment(Keys, First, Candidate, Tolerance))
+			{
+				Failed = Candidate;
+				break;
+			}
+			Reached = Candidate;
+		}
+
+		while (Failed - Reached > 1)
+		{
+			const int32 Candidate = Reached + (Failed - Reached) / 2;
+			if (CanReplaceSegment(Keys, First, Candidate, Tolerance))
+			{
+				Reached = Candidate;
+			}
+			else
+			{
+				Failed = Candidate;
+			}
+		}
+		return Reached;
+	}
+}
+
+void FSimpleAnimCurveKeyBuilder::BuildKeys(ERichCurveInterpMode InterpMode, TConstArrayView<float> Times,
+	TConstArrayView<float> Values, TArray<FRichCurveKey>& OutKeys, float Tension, float ReductionTolerance)
+{
+	OutKeys.SetNumUninitialized(Times.Num());
+	BuildKeys(InterpMode, Times, Values, TArrayView<FRichCurveKey>(OutKeys), Tension);
+
+	if (ReductionTolerance > 0.f)
+	{
+		ReduceKeys(OutKeys, ReductionTolerance);
+	}
+}
+
+void FSimpleAnimCurveKeyBuilder::BuildKeys(ERichCurveInterpMode InterpMode, TConstArrayView<float> Times,
+	TConstArrayView<float> Values, TArrayView<FRichCurveKey> OutKeys, float Tension)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(BuildCurveKeys);
+
+	const int32 NumKeys = Times.Num();
+	check(Values.Num() == NumKeys && OutKeys.Num() == NumKeys);
+	if (NumKeys == 0)
+	{
+		return;
+	}
+
+	// Tangent of each key, and the scale from time delta to tangent weight: sqrt(1 + Tangent^2) / 3
+	TArray<float, TInlineAllocator<256>> Tangents;
+	TArray<float, TInlineAllocator<256>> WeightScales;
+	Tangents.SetNumZeroed(NumKeys);
+	WeightScales.SetNumUninitialized(NumKeys);
+
+	// Only inner keys of cubic curves get a tangent, the ends and every key of other curves stay flat
+	if (InterpMode == RCIM_Cubic && NumKeys > 2)
+	{
+		// Same as ComputeCurveTangent(): (1 - Tension) * (Next - Prev) / (NextTime - PrevTime)
+		const float TensionScale = 1.f - Tension;
+		const VectorRegister4Float TensionScales = VectorSetFloat1(TensionScale);
+		const VectorRegister4Float MinTimeDelta = VectorSetFloat1(UE_KINDA_SMALL_NUMBER);
+
+		const float* TimeData = Times.GetData();
+		const float* ValueData = Values.GetData();
+		int32 KeyIndex = 1;
+		for (; KeyIndex + 4 < NumKeys; KeyIndex += 4)
+		{
+			const VectorRegister4Float ValueDelta = VectorSubtract(VectorLoad(ValueData + KeyIndex + 1), VectorLoad(ValueData + KeyIndex - 1));
+			const VectorRegister4Float TimeDelta = VectorMax(VectorSubtract(VectorLoad(TimeData + KeyIndex + 1), VectorLoad(TimeData + KeyIndex - 1)), MinTimeDelta);
+			VectorStore(VectorDivide(VectorMultiply(ValueDelta, TensionScales), TimeDelta), Tangents.GetData() + KeyIndex);
+		}
+		for (; KeyIndex < NumKeys - 1; ++KeyIndex)
+		{
+			const float TimeDelta = FMath::Max(UE_KINDA_SMALL_NUMBER, Times[KeyIndex + 1] - Times[KeyIndex - 1]);
+			Tangents[KeyIndex] = TensionScale * (Values[KeyIndex + 1] - Values[KeyIndex - 1]) / TimeDelta;
+		}
+	}
+
+	// Weights use the final tangents
+	{
+		constexpr float OneThird = 1.f / 3.f;
+		const VectorRegister4Float OneThirds = VectorSetFloat1(OneThird);
+		const VectorRegister4Float One = VectorOne();
+
+		int32 KeyIndex = 0;
+		for (; KeyIndex + 4 <= NumKeys; KeyIndex += 4)
+		{
+			const VectorRegister4Float Tangent = VectorLoad(Tangents.GetData() + KeyIndex);
+			VectorStore(VectorMultiply(VectorSqrt(VectorMultiplyAdd(Tangent, Tangent, One)), OneThirds), WeightScales.GetData() + KeyIndex);
+		}
+		for (; KeyIndex < NumKeys; ++KeyIndex)
+		{
+			WeightScales[KeyIndex] = FMath::Sqrt(1.f + FMath::Square(Tangents[KeyIndex])) * OneThird;
+		}
+	}
+
+	// Write every key once
+	for (int32 KeyIndex = 0; KeyIndex < NumKeys; ++KeyIndex)
+	{
+		FRichCurveKey& Key = OutKeys[KeyIndex];
+		Key.InterpMode = InterpMode;
+		Key.TangentMode = RCTM_Auto;
+		Key.TangentWeightMode = RCTWM_WeightedNone;
+		Key.Time = Times[KeyIndex];
+		Key.Value = Values[KeyIndex];
+		Key.ArriveTangent = Tangents[KeyIndex];
+		Key.LeaveTangent = Tangents[KeyIndex];
+		Key.ArriveTangentWeight = KeyIndex > 0 ? (Times[KeyIndex] - Times[KeyIndex - 1]) * WeightScales[KeyIndex] : 0.f;
+		Key.LeaveTangentWeight = KeyIndex < NumKeys - 1 ? (Times[KeyIndex + 1] - Times[KeyIndex]) * WeightScales[KeyIndex] : 0.f;
+	}
+
+	SIMPLEANIM_INC_STAT_BY(STAT_SimpleAnim_KeysWritten, NumKeys);
+}
+
+void FSimpleAnimCurveKeyBuilder::BuildKeysBatch(ERichCurveInterpMode InterpMode, TConstArrayView<TArray<float>> Times,
+	TConstArrayView<TArray<float>> Values, TArray<TArray<FRichCurveKey>>& OutKeys, float Tension,
+	float ReductionTolerance)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(BuildCurveKeysBatch);
+
+	check(Times.Num() == Values.Num());
+	OutKeys.SetNum(Times.Num());
+
+	// Curves don't share anything, so each can be built on any thread
+	ParallelFor(Times.Num(), [&](int32 CurveIndex)
+	{
+		BuildKeys(InterpMode, Times[CurveIndex], Values[CurveIndex], OutKeys[CurveIndex], Tension, ReductionTolerance);
+	});
+}
+
+int32 FSimpleAnimCurveKeyBuilder::ReduceKeys(TArray<FRichCurveKey>& Keys, float Tolerance)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(ReduceCurveKeys);
+
+	const int32 NumKeys = Keys.Num();
+	if (NumKeys <= 2 || Tolerance < 0.f)
+	{
+		return 0;
+	}
+
+	TArray<FRichCurveKey> ReducedKeys;
+	ReducedKeys.Reserve(NumKeys);
+	ReducedKeys.Add(Keys[0]);
+
+	// Extend each segment as far as it can replace every key it skips
+	int32 First = 0;
+	while (First < NumKeys - 1)
+	{
+		const int32 Limit = SimpleAnimCurveKeyBuilder::GetSegmentLimit(Keys, First);
+		const int32 Last = SimpleAnimCurveKeyBuilder::FindSegmentEnd(Keys, First, Limit, Tolerance);
+
+		ReducedKeys.Add(Keys[Last]);
+		First = Last;
+	}
+
+	const int32 NumRemoved = NumKeys - ReducedKeys.Num();
+	if (NumRemoved == 0)
+	{
+		return 0;
+	}
+
+	// Kept tangents were checked against the removed keys, recalculating them from the new neighbours would undo that
+	for (FRichCurveKey& Key : ReducedKeys)
+	{
+		if (Key.InterpMode == RCIM_Cubic && Key.TangentMode == RCTM_Auto)
+		{
+			Key.TangentMode = RCTM_User;
+		}
+	}
+
+	Keys = MoveTemp(ReducedKeys);
+	return NumRemoved;
+}
@@ -0,0 +1,281 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimDebugDraw.h"
+
+#if UE_ENABLE_DEBUG_DRAWING
+#include "SimpleAnimStats.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "UObject/ObjectKey.h"
+
+namespace SimpleAnimDebugDraw
+{
+	/** Line end points in body space for each LOD, line N is Points[2N] to Points[2N + 1] */
+	struct FCachedBodyGeometry
+	{
+		FGuid BodySetupGuid;
+		uint8 BuiltLODs = 0;
+		TArray<FVector> Points[FSimpleAnimDebugDraw::NumLODs];
+	};
+
+	/** Cache is dropped when it grows past this, rather than tracking destroyed body setups */
+	static constexpr int32 MaxCachedBodySetups = 4096;
+
+	static TMap<TObjectKey<UBodySetup>, FCachedBodyGeometry> BodyGeometryCache;
+
+	template<typename AllocatorType>
+	static void AddLine(TArray<FVector, AllocatorType>& Points, const FVector& Start, const FVector& End)
+	{
+		Points.Add(Start);
+		Points.Add(End);
+	}
+
+	template<typename AllocatorType>
+	static void AddSphere(TArray<FVector, AllocatorType>& Points, const FVector& Center, float Radius, int32 Segments)
+	{
+		// Same rings as DrawDebugSphere(), which sweeps latitude a full turn and draws every line twice
+		// Half a turn covers the whole sphere, as long as there is an even number of segments
+		Segments = FMath::Max(Segments, 4);
+		Segments += Segments % 2;
+		const float AngleInc = 2.f * UE_PI / static_cast<float>(Segments);
+
+		float SinY1 = 0.f;
+		float CosY1 = 1.f;
+		float Latitude = AngleInc;
+		for (int32 SegmentY = 0; SegmentY < Segments / 2; ++SegmentY)
+		{
+			const float SinY2 = FMath::Sin(Latitude);
+			const float CosY2 = FMath::Cos(Latitude);
+
+			FVector Vertex1 = FVector(SinY1, 0.f, CosY1) * Radius + Center;
+			FVector Vertex3 = FVector(SinY2, 0.f, CosY2) * Radius + Center;
+			float Longitude = AngleInc;
+			for (int32 SegmentX = 0; SegmentX < Segments; ++SegmentX)
+			{
+				const float SinX = FMath::Sin(Longitude);
+				const float CosX = FMath::Cos(Longitude);
+
+				const FVector Vertex2 = FVector(CosX * SinY1, SinX * SinY1, CosY1) * Radius + Center;
+				const FVector Vertex4 = FVector(CosX * SinY2, SinX * SinY2, CosY2) * Radius + Center;
+
+				AddLine(Points, Vertex1, Vertex2);
+				AddLine(Points, Vertex1, Vertex3);
+
+				Vertex1 = Vertex2;
+				Vertex3 = Vertex4;
+				Longitude += AngleInc;
+			}
+			SinY1 = SinY2;
+			CosY1 = CosY2;
+			Latitude += AngleInc;
+		}
+	}
+
+	template<typename AllocatorType>
+	static void AddBox(TArray<FVector, AllocatorType>& Points, const FVector& Center, const FVector& Extent, const FQuat& Rotation)
+	{
+		FVector Corners[8];
+		for (int32 CornerIndex = 0; CornerIndex < 8; ++CornerIndex)
+		{
+			const FVector Sign((CornerIndex & 1) ? 1.f : -1.f, (CornerIndex & 2) ? 1.f : -1.f, (CornerIndex & 4) ? 1.f : -1.f);
+			Corners[CornerIndex] = Center + Rotation.RotateVector(Extent * Sign);
+		}
+
+		// Connect each corner to the corners that differ by a single axis
+		for (int32 CornerIndex = 0; CornerIndex < 8; ++CornerIndex)
+		{
+			for (int32 Axis = 1; Axis < 8; Axis <<= 1)
+			{
+				if (!(CornerIndex & Axis))
+				{
+					AddLine(Points, Corners[CornerIndex], Corners[CornerIndex | Axis]);
+				}
+			}
+		}
+	}
+
+	template<typename AllocatorType>
+	static void AddCircle(TArray<FVector, AllocatorType>& Points, const FVector& Base, const FVector& X, const FVector& Y, float Radius,
+		int32 NumSides, int32 NumSidesToDraw)
+	{
+		const float AngleDelta = 2.f * UE_PI / NumSides;
+		FVector LastVertex = Base + X * Radius;
+		for (int32 SideIndex = 0; SideIndex < NumSidesToDraw; ++SideIndex)
+		{
+			const float Angle = AngleDelta * (SideIndex + 1);
+			const FVector Vertex = Base + (X * FMath::Cos(Angle) + Y * FMath::Sin(Angle)) * Radius;
+			AddLine(Points, LastVertex, Vertex);
+			LastVertex = Vertex;
+		}
+	}
+
+	template<typename AllocatorType>
+	static void AddCapsule(TArray<FVector, AllocatorType>& Points, const FVector& Center, float HalfHeight, float Radius,
+		const FQuat& Rotation, int32 NumSides)
+	{
+		// Same lines as DrawDebugCapsule()
+		const FVector XAxis = Rotation.GetAxisX();
+		const FVector YAxis = Rotation.GetAxisY();
+		const FVector ZAxis = Rotation.GetAxisZ();
+
+		const float HalfAxis = FMath::Max<float>(HalfHeight - Radius, 1.f);
+		const FVector TopEnd = Center + HalfAxis * ZAxis;
+		const FVector BottomEnd = Center - HalfAxis * ZAxis;
+
+		// Top and bottom circles
+		AddCircle(Points, TopEnd, XAxis, YAxis, Radius, NumSides, NumSides);
+		AddCircle(Points, BottomEnd, XAxis, YAxis, Radius, NumSides, NumSides);
+
+		// Domed caps
+		AddCircle(Points, TopEnd, YAxis, ZAxis, Radius, NumSides, NumSides / 2);
+		AddCircle(Points, TopEnd, XAxis, ZAxis, Radius, NumSides, NumSides / 2);
+		AddCircle(Points, BottomEnd, YAxis, -ZAxis, Radius, NumSides, NumSides / 2);
+		AddCircle(Points, BottomEnd, XAxis, -ZAxis, Radius, NumSides, NumSides / 2);
+
+		// Connecting lines
+		AddLine(Points, TopEnd + Radius * XAxis, BottomEnd + Radius * XAxis);
+		AddLine(Points, TopEnd - Radius * XAxis, BottomEnd - Radius * XAxis);
+		AddLine(Points, TopEnd + Radius * YAxis, BottomEnd + Radius * YAxis);
+		AddLine(Points, TopEnd - Radius * YAxis, BottomEnd - Radius * YAxis);
+	}
+
+	static const TArray<FVector>& GetBodyGeometry(const UBodySetup* BodySetup, int32 LOD)
+	{
+		FCachedBodyGeometry* Geometry = BodyGeometryCache.Find(BodySetup);
+		if (!Geometry)
+		{
+			if (BodyGeometryCache.Num() >= MaxCachedBodySetups)
+			{
+				BodyGeometryCache.Reset();
+			}
+			Geometry = &BodyGeometryCache.Add(BodySetup);
+		}
+
+		// Body setup was edited, rebuild every LOD as it is requested
+		if (Geometry->BodySetupGuid != BodySetup->BodySetupGuid)
+		{
+			Geometry->BodySetupGuid = BodySetup->BodySetupGuid;
+			Geometry->BuiltLODs = 0;
+		}
+
+		TArray<FVector>& Points = Geometry->Points[LOD];
+		if (Geometry->BuiltLODs & (1 << LOD))
+		{
+			return Points;
+		}
+
+		// Build in body space at unit scale, the body transform is applied when drawing
+		Geometry->BuiltLODs |= 1 << LOD;
+		Points.Reset();
+
+		const FKAggregateGeom& AggGeom = BodySetup->AggGeom;
+		for (const FKSphereElem& Shape : AggGeom.SphereElems)
+		{
+			AddSphere(Points, Shape.Center, Shape.Radius, FSimpleAnimDebugDraw::SphereSegments[LOD]);
+		}
+
+		for (const FKBoxElem& Shape : AggGeom.BoxElems)
+		{
+			const FVector Extent = FVector(Shape.X, Shape.Y, Shape.Z) * 0.5f;
+			AddBox(Points, Shape.Center, Extent, Shape.Rotation.Quaternion());
+		}
+
+		// Capsules have always been drawn with their length as the half height
+		for (const FKSphylElem& Shape : AggGeom.SphylElems)
+		{
+			AddCapsule(Points, Shape.Center, Shape.Length, Shape.Radius, Shape.Rotation.Quaternion(),
+				FSimpleAnimDebugDraw::CapsuleSides[LOD]);
+		}
+
+		return Points;
+	}
+}
+
+ULineBatchComponent* FSimpleAnimDebugDraw::GetLineBatcher(UWorld* World, bool bPersistentLines, float Duration,
+	float& OutLifeTime)
+{
+	// No debug line drawing on dedicated server
+	if (!World || !GEngine || GEngine->GetNetMode(World) == NM_DedicatedServer)
+	{
+		return nullptr;
+	}
+
+	const bool bPersistentBatcher = bPersistentLines || Duration > 0.f;
+#if ENGINE_MINOR_VERSION >= 5
+	ULineBatchComponent* LineBatcher = World->GetLineBatcher(bPersistentBatcher
+		? UWorld::ELineBatcherType::WorldPersistent : UWorld::ELineBatcherType::World);
+#else
+	ULineBatchComponent* LineBatcher = bPersistentBatcher ? World->PersistentLineBatcher : World->LineBatcher;
+#endif
+
+	if (LineBatcher)
+	{
+		OutLifeTime = bPersistentLines ? -1.f : (Duration > 0.f ? Duration : LineBatcher->DefaultLifeTime);
+	}
+	return LineBatcher;
+}
+
+void FSimpleAnimDebugDraw::AddBodyLines(const UBodySetup* BodySetup, const FTransform& BodyTransform,
+	const FLinearColor& Color, float LifeTime, float Thickness, TArray<FBatchedLine>& OutLines, int32 LOD)
+{
+	LOD = FMath::Clamp(LOD, 0, NumLODs - 1);
+	const TArray<FVector>& Points = SimpleAnimDebugDraw::GetBodyGeometry(BodySetup, LOD);
+
+	SIMPLEANIM_INC_STAT(STAT_SimpleAnim_BodiesDrawn);
+	SIMPLEANIM_INC_STAT_BY(STAT_SimpleAnim_ShapesDrawn, BodySetup->AggGeom.SphereElems.Num() +
+		BodySetup->AggGeom.BoxElems.Num() + BodySetup->AggGeom.SphylElems.Num());
+	if (Points.Num() == 0)
+	{
+		return;
+	}
+
+	const FMatrix BodyMatrix = BodyTransform.ToMatrixWithScale();
+	OutLines.Reserve(OutLines.Num() + Points.Num() / 2);
+	for (int32 PointIndex = 0; PointIndex < Points.Num(); PointIndex += 2)
+	{
+		OutLines.Emplace(BodyMatrix.TransformPosition(Points[PointIndex]), BodyMatrix.TransformPosition(Points[PointIndex + 1]),
+			Color, LifeTime, Thickness, SDPG_World);
+	}
+}
+
+void FSimpleAnimDebugDraw::AddCapsuleLines(const FVector& Center, float HalfHeight, float Radius, const FQuat& Rotation,
+	const FLinearColor& Color, float LifeTime, float Thickness, TArray<FBatchedLine>& OutLines, int32 LOD)
+{
+	// Component capsules change size at runtime, so these are built directly in world space
+	TArray<FVector, TInlineAllocator<128>> Points;
+	SimpleAnimDebugDraw::AddCapsule(Points, Center, HalfHeight, Radius, Rotation, CapsuleSides[FMath::Clamp(LOD, 0, NumLODs - 1)]);
+	SIMPLEANIM_INC_STAT(STAT_SimpleAnim_ShapesDrawn);
+
+	OutLines.Reserve(OutLines.Num() + Points.Num() / 2);
+	for (int32 PointIndex = 0; PointIndex < Points.Num(); PointIndex += 2)
+	{
+		OutLines.Emplace(Points[PointIndex], Points[PointIndex + 1], Color, LifeTime, Thickness, SDPG_World);
+	}
+}
+
+void FSimpleAnimDebugDraw::SubmitLines(ULineBatchComponent* LineBatcher, TArray<FBatchedLine>& Lines)
+{
+	if (LineBatcher && Lines.Num() > 0)
+	{
+		SIMPLEANIM_SCOPE_CYCLE_COUNTER(SubmitLines);
+		SIMPLEANIM_INC_STAT_BY(STAT_SimpleAnim_LinesDrawn, Lines.Num());
+		LineBatcher->DrawLines(Lines);
+	}
+	Lines.Reset();
+}
+
+TArray<FBatchedLine>& FSimpleAnimDebugDraw::GetScratchLines()
+{
+	check(IsInGameThread());
+	static TArray<FBatchedLine> ScratchLines;
+	return ScratchLines;
+}
+
+void FSimpleAnimDebugDraw::ClearCache()
+{
+	SimpleAnimDebugDraw::BodyGeometryCache.Empty();
+	GetScratchLines().Empty();
+}
+#endif
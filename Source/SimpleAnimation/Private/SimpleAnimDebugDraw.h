@@ -0,0 +1,51 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if UE_ENABLE_DEBUG_DRAWING
+#include "Components/LineBatchComponent.h"
+
+class UBodySetup;
+
+/**
+ * Debug drawing for physics bodies from body space line lists that are built once per UBodySetup
+ * Each frame the cached lines are transformed by the body transform and submitted to the line batcher in one call
+ * Game thread only
+ */
+struct FSimpleAnimDebugDraw
+{
+	/** Detail levels for distant shapes, LOD 0 matches DrawDebugSphere() and DrawDebugCapsule() */
+	static constexpr int32 NumLODs = 3;
+
+	/** Segments used for sphere bodies at each LOD */
+	static constexpr int32 SphereSegments[NumLODs] = { 12, 8, 4 };
+
+	/** Sides used for capsules at each LOD */
+	static constexpr int32 CapsuleSides[NumLODs] = { 16, 8, 4 };
+
+	/**
+	 * @return The line batcher DrawDebugLine() would use, or nullptr if debug lines can't be drawn in this world
+	 * @param OutLifeTime Life time to give each line
+	 */
+	static ULineBatchComponent* GetLineBatcher(UWorld* World, bool bPersistentLines, float Duration, float& OutLifeTime);
+
+	/** Append the lines for every shape of the body, transformed by the body's world transform */
+	static void AddBodyLines(const UBodySetup* BodySetup, const FTransform& BodyTransform, const FLinearColor& Color,
+		float LifeTime, float Thickness, TArray<FBatchedLine>& OutLines, int32 LOD = 0);
+
+	/** Append the lines DrawDebugCapsule() would draw */
+	static void AddCapsuleLines(const FVector& Center, float HalfHeight, float Radius, const FQuat& Rotation,
+		const FLinearColor& Color, float LifeTime, float Thickness, TArray<FBatchedLine>& OutLines, int32 LOD = 0);
+
+	/** Submit every line in one call, and reset the array for reuse */
+	static void SubmitLines(ULineBatchComponent* LineBatcher, TArray<FBatchedLine>& Lines);
+
+	/** Pooled line array to build a frame's lines in without reallocating */
+	static TArray<FBatchedLine>& GetScratchLines();
+
+	/** Drop all cached body geometry */
+	static void ClearCache();
+};
+#endif
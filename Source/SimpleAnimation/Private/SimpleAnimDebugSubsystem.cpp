@@ -0,0 +1,240 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimDebugSubsystem.h"
+
+#include "SimpleAnimStats.h"
+#include "SceneManagement.h"
+#include "SceneView.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "PhysicsEngine/BodySetup.h"
+
+#if UE_ENABLE_DEBUG_DRAWING
+#include "SimpleAnimDebugDraw.h"
+#endif
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SimpleAnimDebugSubsystem)
+
+
+void USimpleAnimDebugSubsystem::RegisterPhysicsBodies(APawn* Pawn, USkeletalMeshComponent* Mesh,
+	const FSimpleAnimDebugRoleSettings& RoleSettings)
+{
+	Register(Pawn, Mesh, false, RoleSettings);
+}
+
+void USimpleAnimDebugSubsystem::RegisterPhysicsCapsule(APawn* Pawn, UCapsuleComponent* Capsule,
+	const FSimpleAnimDebugRoleSettings& RoleSettings)
+{
+	Register(Pawn, Capsule, true, RoleSettings);
+}
+
+void USimpleAnimDebugSubsystem::Register(APawn* Pawn, UPrimitiveComponent* Component, bool bCapsule,
+	const FSimpleAnimDebugRoleSettings& RoleSettings)
+{
+	if (!IsValid(Pawn) || !IsValid(Component))
+	{
+		return;
+	}
+
+	// Replace the settings if already registered
+	for (FRegisteredShape& Shape : Registered)
+	{
+		if (Shape.Component == Component)
+		{
+			Shape.Pawn = Pawn;
+			Shape.RoleSettings = RoleSettings;
+			return;
+		}
+	}
+
+	FRegisteredShape& Shape = Registered.AddDefaulted_GetRef();
+	Shape.Pawn = Pawn;
+	Shape.Component = Component;
+	Shape.RoleSettings = RoleSettings;
+	Shape.bCapsule = bCapsule;
+}
+
+void USimpleAnimDebugSubsystem::Unregister(UPrimitiveComponent* Component)
+{
+	Registered.RemoveAllSwap([Component](const FRegisteredShape& Shape)
+	{
+		return Shape.Component == Component;
+	});
+}
+
+void USimpleAnimDebugSubsystem::UnregisterPawn(APawn* Pawn)
+{
+	Registered.RemoveAllSwap([Pawn](const FRegisteredShape& Shape)
+	{
+		return Shape.Pawn == Pawn;
+	});
+}
+
+bool USimpleAnimDebugSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if UE_ENABLE_DEBUG_DRAWING
+	return Super::ShouldCreateSubsystem(Outer);
+#else
+	return false;
+#endif
+}
+
+bool USimpleAnimDebugSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void USimpleAnimDebugSubsystem::Deinitialize()
+{
+	Registered.Empty();
+	Views.Empty();
+	Super::Deinitialize();
+}
+
+bool USimpleAnimDebugSubsystem::IsTickable() const
+{
+	return bEnabled && Registered.Num() > 0;
+}
+
+TStatId USimpleAnimDebugSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USimpleAnimDebugSubsystem, STATGROUP_Tickables);
+}
+
+void USimpleAnimDebugSubsystem::GatherViews()
+{
+	Views.Reset();
+
+	const UWorld* World = GetWorld();
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		const ULocalPlayer* LocalPlayer = PlayerController ? PlayerController->GetLocalPlayer() : nullptr;
+		if (!LocalPlayer || !LocalPlayer->ViewportClient)
+		{
+			continue;
+		}
+
+		FSceneViewProjectionData ProjectionData;
+		if (LocalPlayer->GetProjectionData(LocalPlayer->ViewportClient->Viewport, ProjectionData))
+		{
+			FDebugView& View = Views.AddDefaulted_GetRef();
+			View.Origin = ProjectionData.ViewOrigin;
+			GetViewFrustumBounds(View.Frustum, ProjectionData.ComputeViewProjectionMatrix(), false);
+		}
+	}
+}
+
+bool USimpleAnimDebugSubsystem::GetBoundsLOD(const FBoxSphereBounds& Bounds, int32& OutLOD) const
+{
+	// Nothing to cull against, e.g. no local players on a listen server that is still loading
+	if (Views.Num() == 0)
+	{
+		OutLOD = 0;
+		return true;
+	}
+
+	// Distance from the nearest view that can see the bounds
+	float NearestDistSq = UE_MAX_FLT;
+	for (const FDebugView& View : Views)
+	{
+		if (bFrustumCull && !View.Frustum.IntersectBox(Bounds.Origin, Bounds.BoxExtent))
+		{
+			continue;
+		}
+
+		const float Dist = FMath::Max(0.f, static_cast<float>(FVector::Dist(View.Origin, Bounds.Origin)) - Bounds.SphereRadius);
+		NearestDistSq = FMath::Min(NearestDistSq, FMath::Square(Dist));
+	}
+
+	if (NearestDistSq == UE_MAX_FLT)
+	{
+		return false;
+	}
+
+	if (MaxDrawDistance > 0.f && NearestDistSq > FMath::Square(MaxDrawDistance))
+	{
+		return false;
+	}
+
+	OutLOD = NearestDistSq > FMath::Square(LOD2Distance) ? 2 : (NearestDistSq > FMath::Square(LOD1Distance) ? 1 : 0);
+	return true;
+}
+
+void USimpleAnimDebugSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+#if UE_ENABLE_DEBUG_DRAWING
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(DebugSubsystemTick);
+
+	float LifeTime = 0.f;
+	ULineBatchComponent* LineBatcher = FSimpleAnimDebugDraw::GetLineBatcher(GetWorld(), false, -1.f, LifeTime);
+	if (!LineBatcher)
+	{
+		return;
+	}
+
+	GatherViews();
+
+	// Gather the lines for every registered shape, then submit them all at once
+	TArray<FBatchedLine>& Lines = FSimpleAnimDebugDraw::GetScratchLines();
+	for (int32 ShapeIndex = Registered.Num() - 1; ShapeIndex >= 0; --ShapeIndex)
+	{
+		const FRegisteredShape& Shape = Registered[ShapeIndex];
+
+		// Drop shapes whose pawn or component has been destroyed
+		const APawn* Pawn = Shape.Pawn.Get();
+		const UPrimitiveComponent* Component = Shape.Component.Get();
+		if (!Pawn || !Component)
+		{
+			Registered.RemoveAtSwap(ShapeIndex);
+			continue;
+		}
+
+		// Check if we should draw based on the role of the pawn
+		FLinearColor Color;
+		if (!Shape.RoleSettings.GetColorForRole(Pawn->GetLocalRole(), Color))
+		{
+			continue;
+		}
+
+		int32 LOD = 0;
+		if (!Component->IsRegistered() || !GetBoundsLOD(Component->Bounds, LOD))
+		{
+			continue;
+		}
+
+		// Match the color DrawDebugLine() would have used
+		Color = FLinearColor(Color.ToFColor(true));
+		const float Thickness = Shape.RoleSettings.Thickness;
+
+		if (Shape.bCapsule)
+		{
+			const UCapsuleComponent* Capsule = CastChecked<UCapsuleComponent>(Component);
+			FSimpleAnimDebugDraw::AddCapsuleLines(Capsule->GetComponentLocation(), Capsule->GetUnscaledCapsuleHalfHeight(),
+				Capsule->GetUnscaledCapsuleRadius(), Capsule->GetComponentQuat(), Color, LifeTime, Thickness, Lines, LOD);
+			continue;
+		}
+
+		const USkeletalMeshComponent* Mesh = CastChecked<USkeletalMeshComponent>(Component);
+		for (const FBodyInstance* BodyInstance : Mesh->Bodies)
+		{
+			const UBodySetup* BodySetup = BodyInstance ? BodyInstance->GetBodySetup() : nullptr;
+			if (IsValid(BodySetup))
+			{
+				FSimpleAnimDebugDraw::AddBodyLines(BodySetup, BodyInstance->GetUnrealWorldTransform(), Color, LifeTime,
+					Thickness, Lines, LOD);
+			}
+		}
+	}
+
+	FSimpleAnimDebugDraw::SubmitLines(LineBatcher, Lines);
+#endif
+}
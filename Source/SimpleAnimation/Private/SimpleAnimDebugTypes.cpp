@@ -0,0 +1,28 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimDebugTypes.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SimpleAnimDebugTypes)
+
+
+bool FSimpleAnimDebugRoleSettings::GetColorForRole(ENetRole NetRole, FLinearColor& OutColor) const
+{
+	// Check if we should draw based on the role
+	switch (NetRole)
+	{
+	case ROLE_SimulatedProxy:
+		if (!bDrawSimulated) { return false; }
+		OutColor = SimulatedColor;
+		return true;
+	case ROLE_AutonomousProxy:
+		if (!bDrawLocal) { return false; }
+		OutColor = LocalColor;
+		return true;
+	case ROLE_Authority:
+		if (!bDrawAuthority) { return false; }
+		OutColor = AuthColor;
+		return true;
+	default: return false;
+	}
+}
@@ -3,9 +3,14 @@
 
 #include "SimpleAnimLib.h"
 
+#include "SimpleAnimStats.h"
+
 #if UE_ENABLE_DEBUG_DRAWING
+#include "SimpleAnimDebugTypes.h"
+#include "SimpleAnimDebugDraw.h"
 #include "PhysicsEngine/BodySetup.h"
 #include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
 #endif
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(SimpleAnimLib)
@@ -16,6 +21,8 @@ void USimpleAnimLib::DrawPawnDebugPhysicsBodies(APawn* Pawn, USkeletalMeshCompon
 	FLinearColor SimulatedColor, const bool bPersistentLines, const float Duration, const float Thickness)
 {
 #if UE_ENABLE_DEBUG_DRAWING
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(DrawPawnDebugPhysicsBodies);
+
 	// Check if we should draw at all
 	if (!bDrawAuthority && !bDrawLocal && !bDrawSimulated)
 	{
@@ -28,26 +35,12 @@ void USimpleAnimLib::DrawPawnDebugPhysicsBodies(APawn* Pawn, USkeletalMeshCompon
 		return;
 	}
 
-	// Determine the role of the pawn
-	const ENetRole NetRole = Pawn->GetLocalRole();
-
-	// Check if we should draw based on the role
+	// Check if we should draw based on the role of the pawn
+	const FSimpleAnimDebugRoleSettings RoleSettings { bDrawAuthority, bDrawLocal, bDrawSimulated, AuthColor, LocalColor, SimulatedColor };
 	FLinearColor Color;
-	switch (NetRole)
+	if (!RoleSettings.GetColorForRole(Pawn->GetLocalRole(), Color))
 	{
-	case ROLE_SimulatedProxy:
-		if (!bDrawSimulated) { return; }
-		Color = SimulatedColor;
-		break;
-	case ROLE_AutonomousProxy:
-		if (!bDrawLocal) { return; }
-		Color = LocalColor;
-		break;
-	case ROLE_Authority:
-		if (!bDrawAuthority) { return; }
-		Color = AuthColor;
-		break;
-	default: return;
+		return;
 	}
 
 	// Draw the physics bodies
@@ -59,59 +52,40 @@ void USimpleAnimLib::DrawDebugPhysicsBodies(USkeletalMeshComponent* Mesh, FLinea
 	const bool bPersistentLines, const float Duration, const float Thickness)
 {
 #if UE_ENABLE_DEBUG_DRAWING
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(DrawDebugPhysicsBodies);
+
 	// Check if we have a valid mesh and world
 	if (!Mesh || !Mesh->GetWorld())
 	{
 		return;
 	}
 
-	UWorld* World = Mesh->GetWorld();
+	float LifeTime = 0.f;
+	ULineBatchComponent* LineBatcher = FSimpleAnimDebugDraw::GetLineBatcher(Mesh->GetWorld(), bPersistentLines, Duration, LifeTime);
+	if (!LineBatcher)
+	{
+		return;
+	}
+
+	// Match the color DrawDebugLine() would have used
+	const FLinearColor Color = FLinearColor(LinearColor.ToFColor(true));
 
-	const FColor Color = LinearColor.ToFColor(true);
-		
-	// Loop through each physics body instance
+	// Gather the lines for every body, then submit them all at once
+	TArray<FBatchedLine>& Lines = FSimpleAnimDebugDraw::GetScratchLines();
 	for (const FBodyInstance* BodyInstance : Mesh->Bodies)
 	{
 		// Get the Body Setup for this bone
-		UBodySetup* BodySetup = BodyInstance->GetBodySetup();
+		const UBodySetup* BodySetup = BodyInstance ? BodyInstance->GetBodySetup() : nullptr;
 		if (!IsValid(BodySetup))
 		{
 			continue;
 		}
 
-		// Get the transform of the body (World Space)
-		FTransform BodyTransform = BodyInstance->GetUnrealWorldTransform();
-
-		// Iterate through all shapes (collisions) for this body and draw them
-		const FVector Scale = BodyTransform.GetScale3D();
-
-		// Draw the sphere elements
-		for (const FKSphereElem& Shape : BodySetup->AggGeom.SphereElems)
-		{
-			const FTransform TM = Shape.GetFinalScaled(Scale, BodyTransform).GetTransform();
-			const float Radius = Shape.Radius * Scale.X;
-			DrawDebugSphere(World, TM.GetLocation(), Radius, 12, Color, bPersistentLines, Duration,
-				0, Thickness);
-		}
-
-		// Draw the box elements
-		for (const FKBoxElem& Shape : BodySetup->AggGeom.BoxElems)
-		{
-			const FTransform TM = Shape.GetFinalScaled(Scale, BodyTransform).GetTransform();
-			const FVector Volume { Shape.X, Shape.Y, Shape.Z };
-			const FVector Extent = Volume * Scale * 0.5f;
-			DrawDebugBox(World, TM.GetLocation(), Extent, TM.GetRotation(), Color, bPersistentLines,
-				Duration, 0, Thickness);
-		}
-
-		// Draw the capsule elements
-		for (const FKSphylElem& Shape : BodySetup->AggGeom.SphylElems)
-		{
-			const FTransform TM = Shape.GetFinalScaled(Scale, BodyTransform).GetTransform();
-			DrawDebugCapsule(World, TM.GetLocation(), Shape.Length, Shape.Radius, TM.GetRotation(), Color,
-				bPersistentLines, Duration, 0, Thickness);
-		}
+		// Shapes are cached in body space, so only the body transform (World Space) is needed
+		FSimpleAnimDebugDraw::AddBodyLines(BodySetup, BodyInstance->GetUnrealWorldTransform(), Color, LifeTime, Thickness, Lines);
 	}
+
+	FSimpleAnimDebugDraw::SubmitLines(LineBatcher, Lines);
 #endif
 }
 
@@ -120,32 +94,20 @@ void USimpleAnimLib::DrawPawnDebugPhysicsCapsule(APawn* Pawn, const UCapsuleComp
 	FLinearColor SimulatedColor, const bool bPersistentLines, const float Duration, const float Thickness)
 {
 #if UE_ENABLE_DEBUG_DRAWING
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(DrawPawnDebugPhysicsCapsule);
+
 	// Check if we have a valid pawn that isn't pending kill
 	if (!IsValid(Pawn))
 	{
 		return;
 	}
 
-	// Determine the role of the pawn
-	const ENetRole NetRole = Pawn->GetLocalRole();
-
-	// Check if we should draw based on the role
+	// Check if we should draw based on the role of the pawn
+	const FSimpleAnimDebugRoleSettings RoleSettings { bDrawAuthority, bDrawLocal, bDrawSimulated, AuthColor, LocalColor, SimulatedColor };
 	FLinearColor Color;
-	switch (NetRole)
+	if (!RoleSettings.GetColorForRole(Pawn->GetLocalRole(), Color))
 	{
-	case ROLE_SimulatedProxy:
-		if (!bDrawSimulated) { return; }
-		Color = SimulatedColor;
-		break;
-	case ROLE_AutonomousProxy:
-		if (!bDrawLocal) { return; }
-		Color = LocalColor;
-		break;
-	case ROLE_Authority:
-		if (!bDrawAuthority) { return; }
-		Color = AuthColor;
-		break;
-	default: return;
+		return;
 	}
 
 	// Draw the capsule
@@ -157,16 +119,25 @@ void USimpleAnimLib::DrawDebugPhysicsCapsule(const UCapsuleComponent* Capsule, F
 	const float Duration, const float Thickness)
 {
 #if UE_ENABLE_DEBUG_DRAWING
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(DrawDebugPhysicsCapsule);
+
 	if (!Capsule || !Capsule->GetWorld())
 	{
 		return;
 	}
 
-	const FColor LineColor = Color.ToFColor(true);
-	const UWorld* World = Capsule->GetWorld();
+	float LifeTime = 0.f;
+	ULineBatchComponent* LineBatcher = FSimpleAnimDebugDraw::GetLineBatcher(Capsule->GetWorld(), bPersistentLines, Duration, LifeTime);
+	if (!LineBatcher)
+	{
+		return;
+	}
+
+	const FLinearColor LineColor = FLinearColor(Color.ToFColor(true));
 
-	DrawDebugCapsule(World, Capsule->GetComponentLocation(), Capsule->GetUnscaledCapsuleHalfHeight(),
-		Capsule->GetUnscaledCapsuleRadius(), Capsule->GetComponentQuat(), LineColor, bPersistentLines,
-		Duration, 0, Thickness);
+	TArray<FBatchedLine>& Lines = FSimpleAnimDebugDraw::GetScratchLines();
+	FSimpleAnimDebugDraw::AddCapsuleLines(Capsule->GetComponentLocation(), Capsule->GetUnscaledCapsuleHalfHeight(),
+		Capsule->GetUnscaledCapsuleRadius(), Capsule->GetComponentQuat(), LineColor, LifeTime, Thickness, Lines);
+	FSimpleAnimDebugDraw::SubmitLines(LineBatcher, Lines);
 #endif
 }
@@ -0,0 +1,689 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimPhysicsRecorder.h"
+
+#include "SimpleAnimStats.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "PhysicsEngine/BodySetup.h"
+
+#if UE_ENABLE_DEBUG_DRAWING
+#include "SimpleAnimDebugDraw.h"
+#endif
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SimpleAnimPhysicsRecorder)
+
+namespace SimpleAnimPhysicsRecorder
+{
+	/** Recorded state of one mesh, followed in the frame's body data by NumBodies body samples */
+	struct FMeshSample
+	{
+		int32 RecordedMeshIndex;
+		FVector3f Origin;
+		FVector3f Scale;
+		uint16 NumBodies;
+		uint8 Role;
+		uint8 Padding;
+	};
+
+	/** Position from the mesh's origin in steps of the frame's precision, and a smallest three rotation */
+	struct FBodySample
+	{
+		int16 Position[3];
+		uint16 Rotation[3];
+	};
+
+	static_assert(sizeof(FBodySample) == 12, "Body samples should stay packed");
+
+	/** Largest budget in kilobytes, so the ring buffer can be indexed with int32 */
+	static constexpr int32 MaxMemoryBudgetKB = 1024 * 1024;
+
+	/** Bits per stored quaternion component */
+	static constexpr int32 RotationBits = 15;
+	static constexpr float RotationScale = static_cast<float>((1 << RotationBits) - 1);
+
+	/**
+	 * Drop the largest component, which can be rebuilt from the others because the quaternion is normalized
+	 * The others are at most 1/sqrt(2), so each fits in 15 bits, plus 2 bits for which component was dropped
+	 */
+	static void PackRotation(const FQuat& Rotation, uint16 (&OutWords)[3])
+	{
+		const FQuat Quat = Rotation.GetNormalized();
+		const float Components[4] = { static_cast<float>(Quat.X), static_cast<float>(Quat.Y), static_cast<float>(Quat.Z),
+			static_cast<float>(Quat.W) };
+
+		int32 Largest = 0;
+		for (int32 Index = 1; Index < 4; ++Index)
+		{
+			if (FMath::Abs(Components[Index]) > FMath::Abs(Components[Largest]))
+			{
+				Largest = Index;
+			}
+		}
+
+		// q and -q are the same rotation, so the dropped component is always positive
+		const float Sign = Components[Largest] < 0.f ? -1.f : 1.f;
+
+		uint64 Bits = static_cast<uint64>(Largest);
+		int32 Shift = 2;
+		for (int32 Index = 0; Index < 4; ++Index)
+		{
+			if (Index != Largest)
+			{
+				const float Normalized = FMath::Clamp(Components[Index] * Sign * UE_HALF_SQRT_2 + 0.5f, 0.f, 1.f);
+				Bits |= static_cast<uint64>(FMath::RoundToInt(Normalized * RotationScale)) << Shift;
+				Shift += RotationBits;
+			}
+		}
+
+		OutWords[0] = static_cast<uint16>(Bits);
+		OutWords[1] = static_cast<uint16>(Bits >> 16);
+		OutWords[2] = static_cast<uint16>(Bits >> 32);
+	}
+
+	static FQuat UnpackRotation(const uint16 (&Words)[3])
+	{
+		const uint64 Bits = static_cast<uint64>(Words[0]) | (static_cast<uint64>(Words[1]) << 16) | (static_cast<uint64>(Words[2]) << 32);
+		const int32 Largest = static_cast<int32>(Bits & 3);
+
+		float Components[4];
+		float SumSq = 0.f;
+		int32 Shift = 2;
+		for (int32 Index = 0; Index < 4; ++Index)
+		{
+			if (Index != Largest)
+			{
+				const float Normalized = static_cast<float>((Bits >> Shift) & ((1 << RotationBits) - 1)) / RotationScale;
+				Components[Index] = (Normalized - 0.5f) * UE_SQRT_2;
+				SumSq += FMath::Square(Components[Index]);
+				Shift += RotationBits;
+			}
+		}
+		Components[Largest] = FMath::Sqrt(FMath::Max(0.f, 1.f - SumSq));
+
+		return FQuat(Components[0], Components[1], Components[2], Components[3]).GetNormalized();
+	}
+
+	/** Allocate as many bytes as fit within Bytes once the allocator has rounded the allocation up */
+	static void AllocateWithin(TArray<uint8>& Data, int32 Bytes)
+	{
+		int32 Num = Bytes;
+		Data.Empty(Num);
+		while (Num > 0 && Data.GetAllocatedSize() > static_cast<SIZE_T>(Bytes))
+		{
+			Num -= static_cast<int32>(Data.GetAllocatedSize() - Bytes);
+			Data.Empty(FMath::Max(Num, 0));
+		}
+		Data.SetNumUninitialized(FMath::Max(Num, 0));
+	}
+
+	static int16 PackPosition(double Offset, float InvPrecision)
+	{
+		return static_cast<int16>(FMath::Clamp(FMath::RoundToInt(static_cast<float>(Offset) * InvPrecision), -MAX_int16, MAX_int16));
+	}
+}
+
+void USimpleAnimPhysicsRecorder::RegisterPhysicsBodies(APawn* Pawn, USkeletalMeshComponent* Mesh,
+	const FSimpleAnimDebugRoleSettings& RoleSettings)
+{
+	if (!IsValid(Pawn) || !IsValid(Mesh))
+	{
+		return;
+	}
+
+	// Replace the settings if already registered, frames recorded so far keep the colors they were recorded with
+	for (FRegisteredMesh& Entry : Registered)
+	{
+		if (Entry.Mesh == Mesh)
+		{
+			Entry.Pawn = Pawn;
+			Entry.RoleSettings = RoleSettings;
+			Entry.RecordedMeshIndex = INDEX_NONE;
+			PruneRecordedMeshes(true);
+			return;
+		}
+	}
+
+	FRegisteredMesh& Entry = Registered.AddDefaulted_GetRef();
+	Entry.Pawn = Pawn;
+	Entry.Mesh = Mesh;
+	Entry.RoleSettings = RoleSettings;
+	PruneRecordedMeshes(true);
+}
+
+void USimpleAnimPhysicsRecorder::Unregister(USkeletalMeshComponent* Mesh)
+{
+	Registered.RemoveAllSwap([Mesh](const FRegisteredMesh& Entry)
+	{
+		return Entry.Mesh == Mesh;
+	});
+}
+
+void USimpleAnimPhysicsRecorder::UnregisterPawn(APawn* Pawn)
+{
+	Registered.RemoveAllSwap([Pawn](const FRegisteredMesh& Entry)
+	{
+		return Entry.Pawn == Pawn;
+	});
+}
+
+void USimpleAnimPhysicsRecorder::StartRecording()
+{
+	StopPlayback();
+
+	// Reallocate if the budget changed since the last recording, dropping what was recorded with the old budget
+	const int32 BudgetBytes = FMath::Clamp(MemoryBudgetKB, 64, SimpleAnimPhysicsRecorder::MaxMemoryBudgetKB) * 1024;
+	const int32 FrameCapacity = FMath::Clamp(MaxFrames, 1, BudgetBytes / 4 / static_cast<int32>(sizeof(FRecordedFrame)));
+	if (RecordingBudget != BudgetBytes || Frames.Num() != FrameCapacity)
+	{
+		ClearRecording();
+		RecordingBudget = BudgetBytes;
+
+		// Frame bookkeeping and the shapes frames are drawn with come out of the budget, frame data gets the rest
+		Frames.Empty(FrameCapacity);
+		Frames.SetNum(FrameCapacity);
+		RecordedMeshBudget = BudgetBytes / 8;
+		SimpleAnimPhysicsRecorder::AllocateWithin(Data, BudgetBytes - static_cast<int32>(Frames.GetAllocatedSize()) -
+			static_cast<int32>(RecordedMeshBudget));
+	}
+
+	bRecording = true;
+}
+
+void USimpleAnimPhysicsRecorder::StopRecording()
+{
+	bRecording = false;
+	bResumeRecording = false;
+}
+
+void USimpleAnimPhysicsRecorder::ClearRecording()
+{
+	StopPlayback();
+	StopRecording();
+
+	Data.Empty();
+	Frames.Empty();
+	WriteOffset = 0;
+	FirstFrame = 0;
+	NumFrames = 0;
+	RecordingBudget = 0;
+
+	RecordedMeshes.Empty();
+	RecordedMeshBudget = 0;
+	for (FRegisteredMesh& Entry : Registered)
+	{
+		Entry.RecordedMeshIndex = INDEX_NONE;
+	}
+}
+
+int64 USimpleAnimPhysicsRecorder::GetRecordingMemory() const
+{
+	return static_cast<int64>(Data.GetAllocatedSize() + Frames.GetAllocatedSize()) + GetRecordedMeshMemory();
+}
+
+int64 USimpleAnimPhysicsRecorder::GetRecordedMeshMemory() const
+{
+	int64 Bytes = RecordedMeshes.GetAllocatedSize();
+	for (const FRecordedMesh& Recorded : RecordedMeshes)
+	{
+		Bytes += Recorded.BodySetups.GetAllocatedSize();
+	}
+	return Bytes;
+}
+
+void USimpleAnimPhysicsRecorder::ScrubToFrame(int32 FramesAgo)
+{
+	if (NumFrames == 0)
+	{
+		return;
+	}
+
+	// Recording would drop the frames being looked at
+	if (PlaybackFrame == INDEX_NONE)
+	{
+		bResumeRecording = bRecording;
+		bRecording = false;
+	}
+
+	PlaybackFrame = NumFrames - 1 - FMath::Clamp(FramesAgo, 0, NumFrames - 1);
+	bPlaying = false;
+}
+
+void USimpleAnimPhysicsRecorder::StartPlayback(int32 FramesAgo, float PlayRate)
+{
+	ScrubToFrame(FramesAgo < 0 ? NumFrames - 1 : FramesAgo);
+	if (PlaybackFrame == INDEX_NONE)
+	{
+		return;
+	}
+
+	bPlaying = true;
+	PlaybackRate = PlayRate;
+	PlaybackTime = Frames[(FirstFrame + PlaybackFrame) % Frames.Num()].Time;
+}
+
+void USimpleAnimPhysicsRecorder::StopPlayback()
+{
+	if (PlaybackFrame == INDEX_NONE)
+	{
+		return;
+	}
+
+	PlaybackFrame = INDEX_NONE;
+	bPlaying = false;
+	bRecording = bResumeRecording;
+	bResumeRecording = false;
+}
+
+int32 USimpleAnimPhysicsRecorder::GetPlaybackFrame() const
+{
+	return PlaybackFrame == INDEX_NONE ? -1 : NumFrames - 1 - PlaybackFrame;
+}
+
+bool USimpleAnimPhysicsRecorder::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if UE_ENABLE_DEBUG_DRAWING
+	return Super::ShouldCreateSubsystem(Outer);
+#else
+	return false;
+#endif
+}
+
+bool USimpleAnimPhysicsRecorder::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void USimpleAnimPhysicsRecorder::Deinitialize()
+{
+	ClearRecording();
+	Registered.Empty();
+	Super::Deinitialize();
+}
+
+bool USimpleAnimPhysicsRecorder::IsTickable() const
+{
+	return PlaybackFrame != INDEX_NONE || (bRecording && Registered.Num() > 0);
+}
+
+TStatId USimpleAnimPhysicsRecorder::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USimpleAnimPhysicsRecorder, STATGROUP_Tickables);
+}
+
+void USimpleAnimPhysicsRecorder::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(PhysicsRecorderTick);
+
+	if (PlaybackFrame != INDEX_NONE)
+	{
+		// Advance to the last frame recorded at or before the playback time, and hold the newest frame at the end
+		if (bPlaying)
+		{
+			PlaybackTime += DeltaTime * PlaybackRate;
+			while (PlaybackFrame + 1 < NumFrames && Frames[(FirstFrame + PlaybackFrame + 1) % Frames.Num()].Time <= PlaybackTime)
+			{
+				++PlaybackFrame;
+			}
+		}
+		DrawFrame(PlaybackFrame);
+		return;
+	}
+
+	// Nothing moves while paused, so there is nothing new to record
+	if (bRecording && !GetWorld()->IsPaused())
+	{
+		RecordFrame();
+	}
+}
+
+int32 USimpleAnimPhysicsRecorder::GetRecordedMeshIndex(int32 RegisteredIndex)
+{
+	FRegisteredMesh& Entry = Registered[RegisteredIndex];
+	const TArray<FBodyInstance*>& Bodies = Entry.Mesh->Bodies;
+
+	if (RecordedMeshes.IsValidIndex(Entry.RecordedMeshIndex))
+	{
+		const FRecordedMesh& Recorded = RecordedMeshes[Entry.RecordedMeshIndex];
+		bool bMatches = Recorded.BodySetups.Num() == Bodies.Num();
+		for (int32 BodyIndex = 0; bMatches && BodyIndex < Bodies.Num(); ++BodyIndex)
+		{
+			bMatches = Recorded.BodySetups[BodyIndex] == (Bodies[BodyIndex] ? Bodies[BodyIndex]->GetBodySetup() : nullptr);
+		}
+
+		if (bMatches)
+		{
+			return Entry.RecordedMeshIndex;
+		}
+	}
+
+	// Bodies changed, e.g. a new physics asset, keep the old ones for frames already recorded with them
+	FRecordedMesh& Recorded = RecordedMeshes.AddDefaulted_GetRef();
+	Recorded.RoleSettings = Entry.RoleSettings;
+	Recorded.BodySetups.Reserve(Bodies.Num());
+	for (const FBodyInstance* BodyInstance : Bodies)
+	{
+		Recorded.BodySetups.Add(BodyInstance ? BodyInstance->GetBodySetup() : nullptr);
+	}
+
+	Entry.RecordedMeshIndex = RecordedMeshes.Num() - 1;
+
+	// Drop the oldest frames until the shapes only they were drawn with free up enough room
+	while (GetRecordedMeshMemory() > RecordedMeshBudget && NumFrames > 0)
+	{
+		DropOldestFrame();
+		PruneRecordedMeshes(false);
+	}
+
+	// Still too large, so the mesh isn't recorded, pruning kept the order so the new mesh is still last
+	if (GetRecordedMeshMemory() > RecordedMeshBudget)
+	{
+		RecordedMeshes.RemoveAt(Entry.RecordedMeshIndex);
+		RecordedMeshes.Shrink();
+		Entry.RecordedMeshIndex = INDEX_NONE;
+	}
+	return Entry.RecordedMeshIndex;
+}
+
+void USimpleAnimPhysicsRecorder::PruneRecordedMeshes(bool bCheckBodies)
+{
+	using namespace SimpleAnimPhysicsRecorder;
+
+	// Keep meshes still registered, or drawn by a frame that hasn't been dropped
+	TBitArray<> Keep(false, RecordedMeshes.Num());
+	for (const FRegisteredMesh& Entry : Registered)
+	{
+		if (RecordedMeshes.IsValidIndex(Entry.RecordedMeshIndex))
+		{
+			Keep[Entry.RecordedMeshIndex] = true;
+		}
+	}
+
+	const int64 OldestSerial = NumFrames > 0 ? Frames[FirstFrame].Serial : MAX_int64;
+	bool bAnyPruned = false;
+	for (int32 RecordedIndex = 0; RecordedIndex < RecordedMeshes.Num(); ++RecordedIndex)
+	{
+		const FRecordedMesh& Recorded = RecordedMeshes[RecordedIndex];
+		bool bKeep = Keep[RecordedIndex] || Recorded.LastSerial >= OldestSerial;
+
+		// Nothing left to draw once every body setup has been destroyed
+		if (bKeep && bCheckBodies)
+		{
+			bKeep = Recorded.BodySetups.ContainsByPredicate([](const TWeakObjectPtr<const UBodySetup>& BodySetup)
+			{
+				return BodySetup.IsValid();
+			});
+		}
+
+		Keep[RecordedIndex] = bKeep;
+		bAnyPruned |= !bKeep;
+	}
+
+	if (!bAnyPruned)
+	{
+		return;
+	}
+
+	// Compact the kept meshes, and remap every index that refers to them
+	TArray<int32> Remap;
+	Remap.Init(INDEX_NONE, RecordedMeshes.Num());
+	int32 NumKept = 0;
+	for (int32 RecordedIndex = 0; RecordedIndex < RecordedMeshes.Num(); ++RecordedIndex)
+	{
+		if (Keep[RecordedIndex])
+		{
+			if (NumKept != RecordedIndex)
+			{
+				RecordedMeshes[NumKept] = MoveTemp(RecordedMeshes[RecordedIndex]);
+			}
+			Remap[RecordedIndex] = NumKept++;
+		}
+	}
+	RecordedMeshes.SetNum(NumKept);
+	RecordedMeshes.Shrink();
+
+	for (FRegisteredMesh& Entry : Registered)
+	{
+		if (Remap.IsValidIndex(Entry.RecordedMeshIndex))
+		{
+			Entry.RecordedMeshIndex = Remap[Entry.RecordedMeshIndex];
+		}
+	}
+
+	// Frames that drew a pruned mesh skip it
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+	{
+		const FRecordedFrame& Frame = Frames[(FirstFrame + FrameIndex) % Frames.Num()];
+		uint8* MeshData = Data.GetData() + Frame.Offset;
+		for (int32 MeshIndex = 0; MeshIndex < Frame.NumMeshes; ++MeshIndex, MeshData += sizeof(FMeshSample))
+		{
+			FMeshSample MeshSample;
+			FMemory::Memcpy(&MeshSample, MeshData, sizeof(FMeshSample));
+			MeshSample.RecordedMeshIndex = Remap.IsValidIndex(MeshSample.RecordedMeshIndex) ? Remap[MeshSample.RecordedMeshIndex] : INDEX_NONE;
+			FMemory::Memcpy(MeshData, &MeshSample, sizeof(FMeshSample));
+		}
+	}
+}
+
+void USimpleAnimPhysicsRecorder::DropOldestFrame()
+{
+	FirstFrame = (FirstFrame + 1) % Frames.Num();
+	--NumFrames;
+}
+
+void USimpleAnimPhysicsRecorder::RecordFrame()
+{
+	using namespace SimpleAnimPhysicsRecorder;
+
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(PhysicsRecorderRecordFrame);
+
+	// Drop meshes whose pawn or mesh has been destroyed
+	const bool bAnyUnregistered = Registered.RemoveAllSwap([](const FRegisteredMesh& Entry)
+	{
+		return !Entry.Pawn.IsValid() || !Entry.Mesh.IsValid();
+	}) > 0;
+
+	// Gather what to record first, so the frame's size is known before making room for it
+	struct FMeshToRecord
+	{
+		int32 RegisteredIndex;
+		ENetRole Role;
+	};
+	TArray<FMeshToRecord, TInlineAllocator<16>> MeshesToRecord;
+	int32 Size = 0;
+	for (int32 RegisteredIndex = 0; RegisteredIndex < Registered.Num(); ++RegisteredIndex)
+	{
+		const FRegisteredMesh& Entry = Registered[RegisteredIndex];
+		const USkeletalMeshComponent* Mesh = Entry.Mesh.Get();
+		const ENetRole Role = Entry.Pawn->GetLocalRole();
+
+		// Roles that wouldn't be drawn aren't recorded
+		FLinearColor Color;
+		if (!Mesh->IsRegistered() || Mesh->Bodies.Num() == 0 || Mesh->Bodies.Num() > MAX_uint16 ||
+			!Entry.RoleSettings.GetColorForRole(Role, Color))
+		{
+			continue;
+		}
+
+		// Shapes that don't fit within their share of the budget can't be drawn
+		if (GetRecordedMeshIndex(RegisteredIndex) == INDEX_NONE)
+		{
+			continue;
+		}
+
+		MeshesToRecord.Add({ RegisteredIndex, Role });
+		Size += static_cast<int32>(sizeof(FMeshSample)) + Mesh->Bodies.Num() * static_cast<int32>(sizeof(FBodySample));
+	}
+
+	// A frame larger than the whole budget can't be recorded
+	if (MeshesToRecord.Num() == 0 || Size > Data.Num())
+	{
+		if (bAnyUnregistered)
+		{
+			PruneRecordedMeshes(false);
+		}
+		return;
+	}
+
+	// Frames are contiguous, so wrap to the start if this one doesn't fit before the end
+	const bool bWrap = WriteOffset + Size > Data.Num();
+	const int32 Offset = bWrap ? 0 : WriteOffset;
+
+	// Drop the oldest frames until this one fits, frames after a wrap point are older than any before it
+	bool bAnyDropped = false;
+	while (NumFrames > 0)
+	{
+		const FRecordedFrame& Oldest = Frames[FirstFrame];
+		const bool bOverlaps = Oldest.Offset < Offset + Size && Offset < Oldest.Offset + Oldest.Size;
+		const bool bSkipped = bWrap && Oldest.Offset >= WriteOffset;
+		if (NumFrames < Frames.Num() && !bOverlaps && !bSkipped)
+		{
+			break;
+		}
+		DropOldestFrame();
+		bAnyDropped = true;
+	}
+
+	// Shapes only the dropped frames were drawn with are no longer needed
+	if (bAnyDropped || bAnyUnregistered)
+	{
+		PruneRecordedMeshes(false);
+	}
+
+	FRecordedFrame& Frame = Frames[(FirstFrame + NumFrames) % Frames.Num()];
+	++NumFrames;
+	Frame.Serial = NextFrameSerial++;
+	Frame.Time = GetWorld()->GetTimeSeconds();
+	Frame.PositionPrecision = FMath::Max(PositionPrecision, 0.001f);
+	Frame.Offset = Offset;
+	Frame.Size = Size;
+	Frame.NumMeshes = MeshesToRecord.Num();
+	WriteOffset = Offset + Size;
+
+	const float InvPrecision = 1.f / Frame.PositionPrecision;
+	uint8* MeshData = Data.GetData() + Offset;
+	uint8* BodyData = MeshData + MeshesToRecord.Num() * sizeof(FMeshSample);
+	for (const FMeshToRecord& ToRecord : MeshesToRecord)
+	{
+		const USkeletalMeshComponent* Mesh = Registered[ToRecord.RegisteredIndex].Mesh.Get();
+		const TArray<FBodyInstance*>& Bodies = Mesh->Bodies;
+
+		FMeshSample MeshSample;
+		MeshSample.RecordedMeshIndex = Registered[ToRecord.RegisteredIndex].RecordedMeshIndex;
+		RecordedMeshes[MeshSample.RecordedMeshIndex].LastSerial = Frame.Serial;
+		MeshSample.NumBodies = static_cast<uint16>(Bodies.Num());
+		MeshSample.Role = static_cast<uint8>(ToRecord.Role);
+		MeshSample.Padding = 0;
+
+		// Positions are stored from the first body rather than the component, which a ragdoll can leave behind
+		FVector Origin = Mesh->GetComponentLocation();
+		FVector Scale = Mesh->GetComponentScale();
+		for (const FBodyInstance* BodyInstance : Bodies)
+		{
+			if (BodyInstance)
+			{
+				const FTransform BodyTransform = BodyInstance->GetUnrealWorldTransform();
+				Origin = BodyTransform.GetLocation();
+				Scale = BodyTransform.GetScale3D();
+				break;
+			}
+		}
+		MeshSample.Origin = FVector3f(Origin);
+		MeshSample.Scale = FVector3f(Scale);
+		Origin = FVector(MeshSample.Origin);
+
+		FMemory::Memcpy(MeshData, &MeshSample, sizeof(FMeshSample));
+		MeshData += sizeof(FMeshSample);
+
+		for (const FBodyInstance* BodyInstance : Bodies)
+		{
+			FBodySample BodySample = {};
+			if (BodyInstance)
+			{
+				const FTransform BodyTransform = BodyInstance->GetUnrealWorldTransform();
+				const FVector Position = BodyTransform.GetLocation() - Origin;
+				BodySample.Position[0] = PackPosition(Position.X, InvPrecision);
+				BodySample.Position[1] = PackPosition(Position.Y, InvPrecision);
+				BodySample.Position[2] = PackPosition(Position.Z, InvPrecision);
+				PackRotation(BodyTransform.GetRotation(), BodySample.Rotation);
+			}
+
+			FMemory::Memcpy(BodyData, &BodySample, sizeof(FBodySample));
+			BodyData += sizeof(FBodySample);
+		}
+	}
+}
+
+void USimpleAnimPhysicsRecorder::DrawFrame(int32 FrameIndex) const
+{
+#if UE_ENABLE_DEBUG_DRAWING
+	using namespace SimpleAnimPhysicsRecorder;
+
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(PhysicsRecorderDrawFrame);
+
+	float LifeTime = 0.f;
+	ULineBatchComponent* LineBatcher = FSimpleAnimDebugDraw::GetLineBatcher(GetWorld(), false, -1.f, LifeTime);
+	if (!LineBatcher)
+	{
+		return;
+	}
+
+	const FRecordedFrame& Frame = Frames[(FirstFrame + FrameIndex) % Frames.Num()];
+	const uint8* MeshData = Data.GetData() + Frame.Offset;
+	const uint8* BodyData = MeshData + Frame.NumMeshes * sizeof(FMeshSample);
+
+	// Gather the lines for every recorded body, then submit them all at once
+	TArray<FBatchedLine>& Lines = FSimpleAnimDebugDraw::GetScratchLines();
+	for (int32 MeshIndex = 0; MeshIndex < Frame.NumMeshes; ++MeshIndex)
+	{
+		FMeshSample MeshSample;
+		FMemory::Memcpy(&MeshSample, MeshData, sizeof(FMeshSample));
+		MeshData += sizeof(FMeshSample);
+
+		const uint8* MeshBodyData = BodyData;
+		BodyData += MeshSample.NumBodies * sizeof(FBodySample);
+
+		// Pruned once its bodies were destroyed
+		if (!RecordedMeshes.IsValidIndex(MeshSample.RecordedMeshIndex))
+		{
+			continue;
+		}
+
+		// Color with the role the pawn had when it was recorded
+		const FRecordedMesh& Recorded = RecordedMeshes[MeshSample.RecordedMeshIndex];
+		FLinearColor Color;
+		if (!Recorded.RoleSettings.GetColorForRole(static_cast<ENetRole>(MeshSample.Role), Color))
+		{
+			continue;
+		}
+
+		// Match the color DrawDebugLine() would have used
+		Color = FLinearColor(Color.ToFColor(true));
+
+		const FVector Origin(MeshSample.Origin);
+		const FVector Scale(MeshSample.Scale);
+		for (int32 BodyIndex = 0; BodyIndex < MeshSample.NumBodies; ++BodyIndex)
+		{
+			const UBodySetup* BodySetup = Recorded.BodySetups[BodyIndex].Get();
+			if (!IsValid(BodySetup))
+			{
+				continue;
+			}
+
+			FBodySample BodySample;
+			FMemory::Memcpy(&BodySample, MeshBodyData + BodyIndex * sizeof(FBodySample), sizeof(FBodySample));
+
+			const FVector Position = Origin + FVector(BodySample.Position[0], BodySample.Position[1], BodySample.Position[2]) * Frame.PositionPrecision;
+			const FTransform BodyTransform(UnpackRotation(BodySample.Rotation), Position, Scale);
+			FSimpleAnimDebugDraw::AddBodyLines(BodySetup, BodyTransform, Color, LifeTime, Recorded.RoleSettings.Thickness, Lines);
+		}
+	}
+
+	FSimpleAnimDebugDraw::SubmitLines(LineBatcher, Lines);
+#endif
+}
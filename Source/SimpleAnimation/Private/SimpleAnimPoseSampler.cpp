@@ -0,0 +1,117 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimPoseSampler.h"
+
+#include "BonePose.h"
+#include "SimpleAnimStats.h"
+#include "Animation/AnimCurveTypes.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/AnimationPoseData.h"
+#include "Animation/AttributesRuntime.h"
+#include "Misc/MemStack.h"
+
+FSimpleAnimPoseSampler::FSimpleAnimPoseSampler(const UAnimSequenceBase* InAnimation)
+{
+	if (!InAnimation || !InAnimation->GetSkeleton())
+	{
+		return;
+	}
+
+	Animation = InAnimation;
+	Skeleton = InAnimation->GetSkeleton();
+
+	const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
+	const int32 NumBones = RefSkeleton.GetRawBoneNum();
+
+	// Require every raw bone, so compact pose indices map 1:1 to reference skeleton indices
+	TArray<FBoneIndexType> RequiredBoneIndexArray;
+	RequiredBoneIndexArray.SetNumUninitialized(NumBones);
+	ParentIndices.SetNumUninitialized(NumBones);
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		RequiredBoneIndexArray[BoneIndex] = static_cast<FBoneIndexType>(BoneIndex);
+		ParentIndices[BoneIndex] = RefSkeleton.GetParentIndex(BoneIndex);
+	}
+
+	// We only want bones, don't waste time evaluating curves
+	USkeleton* MutableSkeleton = const_cast<USkeleton*>(Skeleton);
+#if ENGINE_MINOR_VERSION >= 3
+	BoneContainer.InitializeTo(RequiredBoneIndexArray, UE::Anim::FCurveFilterSettings(UE::Anim::ECurveFilterMode::DisallowAll), *MutableSkeleton);
+#else
+	BoneContainer.InitializeTo(RequiredBoneIndexArray, FCurveEvaluationOption(false), *MutableSkeleton);
+#endif
+}
+
+void FSimpleAnimPoseSampler::SampleLocal(float Time, TArray<FTransform>& OutLocal) const
+{
+	const int32 NumBones = GetNumBones();
+	OutLocal.SetNumUninitialized(NumBones);
+	if (!IsValid())
+	{
+		return;
+	}
+
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(SamplePose);
+	SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PosesEvaluated);
+
+	FMemMark Mark(FMemStack::Get());
+
+	FCompactPose CompactPose;
+	CompactPose.SetBoneContainer(&BoneContainer);
+	FBlendedCurve Curve;
+	Curve.InitFrom(BoneContainer);
+	UE::Anim::FStackAttributeContainer Attributes;
+	FAnimationPoseData PoseData(CompactPose, Curve, Attributes);
+
+	const FAnimExtractContext Context(static_cast<double>(Time), false);
+	if (const UAnimSequence* Sequence = Cast<UAnimSequence>(Animation))
+	{
+		// Evaluate raw data, same as the default FAnimPoseEvaluationOptions
+		Sequence->GetBonePose(PoseData, Context, true);
+	}
+	else
+	{
+		Animation->GetAnimationPose(PoseData, Context);
+	}
+
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		OutLocal[BoneIndex] = CompactPose[FCompactPoseBoneIndex(BoneIndex)];
+	}
+}
+
+void FSimpleAnimPoseSampler::Sample(float Time, ESimpleAnimPoseSpace Space, TArray<FTransform>& OutTransforms,
+	const FTransform& ComponentToWorld) const
+{
+	SampleLocal(Time, OutTransforms);
+	if (Space == ESimpleAnimPoseSpace::Local || !IsValid())
+	{
+		return;
+	}
+
+	LocalToComponent(ParentIndices, OutTransforms);
+
+	if (Space == ESimpleAnimPoseSpace::World && !ComponentToWorld.Equals(FTransform::Identity, 0.f))
+	{
+		for (FTransform& Transform : OutTransforms)
+		{
+			Transform = Transform * ComponentToWorld;
+		}
+	}
+}
+
+void FSimpleAnimPoseSampler::LocalToComponent(const TArray<int32>& ParentIndices, TArray<FTransform>& InOutTransforms)
+{
+	check(ParentIndices.Num() == InOutTransforms.Num());
+
+	// Root has no parent, and every other bone's parent has already been converted
+	for (int32 BoneIndex = 1; BoneIndex < InOutTransforms.Num(); ++BoneIndex)
+	{
+		const int32 ParentIndex = ParentIndices[BoneIndex];
+		if (ParentIndex != INDEX_NONE)
+		{
+			InOutTransforms[BoneIndex] = InOutTransforms[BoneIndex] * InOutTransforms[ParentIndex];
+		}
+	}
+}
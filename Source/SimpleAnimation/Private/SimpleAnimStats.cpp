@@ -0,0 +1,15 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimStats.h"
+
+#if SIMPLEANIM_PROFILING_ENABLED
+UE_TRACE_CHANNEL_DEFINE(SimpleAnimationChannel);
+
+DEFINE_STAT(STAT_SimpleAnim_PosesEvaluated);
+DEFINE_STAT(STAT_SimpleAnim_KeysWritten);
+DEFINE_STAT(STAT_SimpleAnim_PackagesDirtied);
+DEFINE_STAT(STAT_SimpleAnim_BodiesDrawn);
+DEFINE_STAT(STAT_SimpleAnim_ShapesDrawn);
+DEFINE_STAT(STAT_SimpleAnim_LinesDrawn);
+#endif
@@ -2,6 +2,8 @@
 
 #include "SimpleAnimation.h"
 
+#include "SimpleAnimDebugDraw.h"
+
 #define LOCTEXT_NAMESPACE "FSimpleAnimationModule"
 
 void FSimpleAnimationModule::StartupModule()
@@ -13,6 +15,9 @@ void FSimpleAnimationModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+#if UE_ENABLE_DEBUG_DRAWING
+	FSimpleAnimDebugDraw::ClearCache();
+#endif
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,49 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Curves/RichCurve.h"
+
+/**
+ * Builds auto tangent curve keys from parallel arrays of times and values, sorted by time
+ * Tangents and tangent weights are computed 4 keys at a time and written straight into the keys,
+ * matching SetAutoKeyInterpolation() followed by AutoSetTangents()
+ */
+struct SIMPLEANIMATION_API FSimpleAnimCurveKeyBuilder
+{
+	/**
+	 * Build one key per time, resizing OutKeys to match
+	 * @param Times Key times, must be sorted ascending
+	 * @param Values Key values, one per time
+	 * @param Tension Tension of the auto tangents
+	 * @param ReductionTolerance If greater than 0, remove keys the curve can do without, see ReduceKeys()
+	 */
+	static void BuildKeys(ERichCurveInterpMode InterpMode, TConstArrayView<float> Times, TConstArrayView<float> Values,
+		TArray<FRichCurveKey>& OutKeys, float Tension = 0.f, float ReductionTolerance = 0.f);
+
+	/** Build one key per time into preallocated keys, OutKeys must have the same number of elements as Times */
+	static void BuildKeys(ERichCurveInterpMode InterpMode, TConstArrayView<float> Times, TConstArrayView<float> Values,
+		TArrayView<FRichCurveKey> OutKeys, float Tension = 0.f);
+
+	/**
+	 * Build the keys for many curves, each curve on its own thread
+	 * @param Times Key times for each curve, each must be sorted ascending
+	 * @param Values Key values for each curve, one per time
+	 * @param OutKeys Resized to one entry per curve
+	 * @param ReductionTolerance If greater than 0, remove keys each curve can do without, see ReduceKeys()
+	 */
+	static void BuildKeysBatch(ERichCurveInterpMode InterpMode, TConstArrayView<TArray<float>> Times,
+		TConstArrayView<TArray<float>> Values, TArray<TArray<FRichCurveKey>>& OutKeys, float Tension = 0.f,
+		float ReductionTolerance = 0.f);
+
+	/**
+	 * Remove every key the curve can do without, while staying within Tolerance of the original curve
+	 * Each segment is extended from the last kept key, and the cubic between the two kept keys is checked against every
+	 * removed key and the midpoint of every original segment it replaces
+	 * Keys with weighted tangents are always kept, and segments never cross a change of interpolation mode
+	 * Kept cubic keys with auto tangents are switched to user tangents, so they aren't recalculated from their new neighbours
+	 * @return Number of keys removed
+	 */
+	static int32 ReduceKeys(TArray<FRichCurveKey>& Keys, float Tolerance);
+};
@@ -0,0 +1,121 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ConvexVolume.h"
+#include "SimpleAnimDebugTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SimpleAnimDebugSubsystem.generated.h"
+
+class APawn;
+class UCapsuleComponent;
+class UPrimitiveComponent;
+class USkeletalMeshComponent;
+
+/**
+ * Draws debug physics for every registered pawn once per frame, instead of each pawn drawing its own from Tick
+ * Shapes outside of every local player's view frustum or beyond MaxDrawDistance are skipped,
+ * and spheres and capsules are drawn with fewer segments as they get further away
+ * Uses the same role rules and colors as USimpleAnimLib::DrawPawnDebugPhysicsBodies()
+ * @note Only created in non-shipping game and PIE worlds
+ */
+UCLASS()
+class SIMPLEANIMATION_API USimpleAnimDebugSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Whether registered shapes are drawn */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bEnabled = true;
+
+	/** Skip shapes outside of every local player's view frustum */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bFrustumCull = true;
+
+	/** Skip shapes further than this from every local player's view, 0 to draw at any distance */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0", ForceUnits="cm"))
+	float MaxDrawDistance = 10000.f;
+
+	/** Beyond this distance spheres and capsules are drawn with fewer segments */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0", ForceUnits="cm"))
+	float LOD1Distance = 1500.f;
+
+	/** Beyond this distance spheres and capsules are drawn with the fewest segments */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0", ForceUnits="cm"))
+	float LOD2Distance = 4000.f;
+
+public:
+	/**
+	 * Draw the physics bodies of a pawn's skeletal mesh component every frame until unregistered
+	 * Registering the same mesh again replaces its role settings
+	 * @param Pawn The pawn whose role determines if and how the bodies are drawn
+	 * @param Mesh The skeletal mesh component to draw physics bodies for
+	 * @param RoleSettings Which roles to draw, and their colors
+	 */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DefaultToSelf="Pawn", DevelopmentOnly))
+	void RegisterPhysicsBodies(APawn* Pawn, USkeletalMeshComponent* Mesh, const FSimpleAnimDebugRoleSettings& RoleSettings);
+
+	/**
+	 * Draw a pawn's capsule every frame until unregistered
+	 * Registering the same capsule again replaces its role settings
+	 * @param Pawn The pawn whose role determines if and how the capsule is drawn
+	 * @param Capsule The capsule component to draw
+	 * @param RoleSettings Which roles to draw, and their colors
+	 */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DefaultToSelf="Pawn", DevelopmentOnly))
+	void RegisterPhysicsCapsule(APawn* Pawn, UCapsuleComponent* Capsule, const FSimpleAnimDebugRoleSettings& RoleSettings);
+
+	/** Stop drawing a component registered with RegisterPhysicsBodies() or RegisterPhysicsCapsule() */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	void Unregister(UPrimitiveComponent* Component);
+
+	/** Stop drawing every component registered for the pawn */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DefaultToSelf="Pawn", DevelopmentOnly))
+	void UnregisterPawn(APawn* Pawn);
+
+	/** @return Number of registered components, including any that have since been destroyed */
+	UFUNCTION(BlueprintPure, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	int32 GetNumRegistered() const { return Registered.Num(); }
+
+protected:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+
+	virtual bool IsTickable() const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void Register(APawn* Pawn, UPrimitiveComponent* Component, bool bCapsule, const FSimpleAnimDebugRoleSettings& RoleSettings);
+
+	/**
+	 * @return False if the bounds are outside of every view, or too far away
+	 * @param OutLOD Detail level to draw with, based on the distance to the nearest view
+	 */
+	bool GetBoundsLOD(const FBoxSphereBounds& Bounds, int32& OutLOD) const;
+
+	/** Gather the view origin and frustum of every local player */
+	void GatherViews();
+
+protected:
+	struct FRegisteredShape
+	{
+		TWeakObjectPtr<const APawn> Pawn;
+		TWeakObjectPtr<const UPrimitiveComponent> Component;
+		FSimpleAnimDebugRoleSettings RoleSettings;
+		bool bCapsule = false;
+	};
+
+	struct FDebugView
+	{
+		FVector Origin;
+		FConvexVolume Frustum;
+	};
+
+	TArray<FRegisteredShape> Registered;
+
+	/** Views gathered for the current frame */
+	TArray<FDebugView> Views;
+};
@@ -0,0 +1,68 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "SimpleAnimDebugTypes.generated.h"
+
+/**
+ * Which net roles to draw debug shapes for, and the color to draw each role with
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATION_API FSimpleAnimDebugRoleSettings
+{
+	GENERATED_BODY()
+
+	FSimpleAnimDebugRoleSettings(const bool bInDrawAuthority = false, const bool bInDrawLocal = true,
+		const bool bInDrawSimulated = false,
+		const FLinearColor& InAuthColor = FLinearColor(1.f, 0.5f, 0.f),		// Orange
+		const FLinearColor& InLocalColor = FLinearColor(0.f, 1.f, 1.f),		// Cyan
+		const FLinearColor& InSimulatedColor = FLinearColor(1.f, 0.f, 1.f),	// Magenta
+		const float InThickness = 0.f)
+		: bDrawAuthority(bInDrawAuthority)
+		, bDrawLocal(bInDrawLocal)
+		, bDrawSimulated(bInDrawSimulated)
+		, AuthColor(InAuthColor)
+		, LocalColor(InLocalColor)
+		, SimulatedColor(InSimulatedColor)
+		, Thickness(InThickness)
+	{}
+
+	/** Whether to draw for the authority role */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bDrawAuthority;
+
+	/** Whether to draw for the local role */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bDrawLocal;
+
+	/** Whether to draw for the simulated role */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bDrawSimulated;
+
+	/** The color of the debug lines for the authority role */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	FLinearColor AuthColor;
+
+	/** The color of the debug lines for the local role */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	FLinearColor LocalColor;
+
+	/** The color of the debug lines for the simulated role */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	FLinearColor SimulatedColor;
+
+	/** The thickness of the debug lines */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0"))
+	float Thickness;
+
+	/** @return True if any role is drawn */
+	bool ShouldDrawAnyRole() const { return bDrawAuthority || bDrawLocal || bDrawSimulated; }
+
+	/**
+	 * @return True if NetRole should be drawn
+	 * @param OutColor The color to draw NetRole with
+	 */
+	bool GetColorForRole(ENetRole NetRole, FLinearColor& OutColor) const;
+};
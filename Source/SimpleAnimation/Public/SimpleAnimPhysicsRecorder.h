@@ -0,0 +1,208 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SimpleAnimDebugTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SimpleAnimPhysicsRecorder.generated.h"
+
+class APawn;
+class UBodySetup;
+class USkeletalMeshComponent;
+
+/**
+ * Records the physics bodies of registered pawns every frame, so a ragdoll or hit reaction can be redrawn after the fact
+ * Frames are stored in a ring buffer within MemoryBudgetKB, the oldest frames are dropped to make room
+ * The shapes and role settings frames are drawn with are kept within an eighth of the budget, and dropped with the last
+ * frame drawn with them
+ * Body positions are stored relative to the mesh's first body in 16 bits per axis, and rotations in 48 bits
+ * Scrubbing or playing back stops recording, and redraws the recorded frame with the same shapes and role colors as
+ * USimpleAnimDebugSubsystem
+ * Doesn't tick unless recording or playing back
+ * @note Only created in non-shipping game and PIE worlds
+ */
+UCLASS()
+class SIMPLEANIMATION_API USimpleAnimPhysicsRecorder : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Memory for everything recorded, allocated when recording starts, a frame too large to fit is not recorded
+	 * An eighth is kept for the shapes frames are drawn with, and MaxFrames is lowered to keep frame bookkeeping within
+	 * a quarter, frame data gets the rest
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="64", UIMin="64", ForceUnits="Kilobytes"))
+	int32 MemoryBudgetKB = 16384;
+
+	/** Most frames kept, lowered if their bookkeeping would take more than a quarter of MemoryBudgetKB */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="1", UIMin="1"))
+	int32 MaxFrames = 1800;
+
+	/** Precision of body positions, bodies can be up to 32767 times this from the mesh's first body */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0.001", ForceUnits="cm"))
+	float PositionPrecision = 0.1f;
+
+public:
+	/**
+	 * Record the physics bodies of a pawn's skeletal mesh component until unregistered
+	 * Registering the same mesh again replaces its role settings
+	 * @param Pawn The pawn whose role determines if the bodies are recorded, and their color when played back
+	 * @param Mesh The skeletal mesh component to record physics bodies for
+	 * @param RoleSettings Which roles to record, and their colors
+	 */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DefaultToSelf="Pawn", DevelopmentOnly))
+	void RegisterPhysicsBodies(APawn* Pawn, USkeletalMeshComponent* Mesh, const FSimpleAnimDebugRoleSettings& RoleSettings);
+
+	/** Stop recording a mesh registered with RegisterPhysicsBodies(), frames already recorded can still be played back */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	void Unregister(USkeletalMeshComponent* Mesh);
+
+	/** Stop recording every mesh registered for the pawn */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DefaultToSelf="Pawn", DevelopmentOnly))
+	void UnregisterPawn(APawn* Pawn);
+
+	/** Start recording a frame every tick, stops any playback */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	void StartRecording();
+
+	/** Stop recording, recorded frames are kept */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	void StopRecording();
+
+	/** Stop recording, and drop every recorded frame and free their memory */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	void ClearRecording();
+
+	UFUNCTION(BlueprintPure, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	bool IsRecording() const { return bRecording; }
+
+	UFUNCTION(BlueprintPure, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	int32 GetNumRecordedFrames() const { return NumFrames; }
+
+	/** @return Bytes allocated for recorded frames, and the shapes they are drawn with, within MemoryBudgetKB */
+	UFUNCTION(BlueprintPure, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	int64 GetRecordingMemory() const;
+
+	/**
+	 * Stop recording and draw a recorded frame every tick, until playback is stopped
+	 * @param FramesAgo 0 for the newest frame, clamped to the oldest frame
+	 */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	void ScrubToFrame(int32 FramesAgo);
+
+	/**
+	 * Stop recording and play the recorded frames back at the speed they were recorded, holding the newest frame at the end
+	 * @param FramesAgo Frame to start from, 0 for the newest frame, or -1 for the oldest frame
+	 * @param PlayRate Multiplier of the recorded speed
+	 */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	void StartPlayback(int32 FramesAgo = -1, float PlayRate = 1.f);
+
+	/** Stop drawing recorded frames, recording resumes if it was stopped by playback */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	void StopPlayback();
+
+	/** @return Frame being drawn, 0 for the newest frame, or -1 if not playing back */
+	UFUNCTION(BlueprintPure, Category=SimpleAnimation, meta=(DevelopmentOnly))
+	int32 GetPlaybackFrame() const;
+
+protected:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+
+	virtual bool IsTickable() const override;
+	virtual bool IsTickableWhenPaused() const override { return true; }
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Append a frame for every registered mesh, dropping the oldest frames to make room */
+	void RecordFrame();
+
+	/** Draw the frame at FrameIndex, counted from the oldest frame */
+	void DrawFrame(int32 FrameIndex) const;
+
+	/**
+	 * @return Index of the recorded mesh matching the mesh's current bodies, adding one if they've changed, or INDEX_NONE
+	 * if a new one doesn't fit within RecordedMeshBudget even after dropping every frame
+	 */
+	int32 GetRecordedMeshIndex(int32 RegisteredIndex);
+
+	/** @return Bytes held by RecordedMeshes */
+	int64 GetRecordedMeshMemory() const;
+
+	/**
+	 * Remove recorded meshes that are no longer registered and not drawn by any remaining frame, and remap the rest
+	 * @param bCheckBodies Also remove meshes whose body setups have all been destroyed
+	 */
+	void PruneRecordedMeshes(bool bCheckBodies);
+
+	void DropOldestFrame();
+
+protected:
+	struct FRegisteredMesh
+	{
+		TWeakObjectPtr<const APawn> Pawn;
+		TWeakObjectPtr<const USkeletalMeshComponent> Mesh;
+		FSimpleAnimDebugRoleSettings RoleSettings;
+
+		/** Entry in RecordedMeshes for the mesh's current bodies */
+		int32 RecordedMeshIndex = INDEX_NONE;
+	};
+
+	/**
+	 * Shapes and colors to play a mesh back with, kept after the mesh is unregistered or its bodies change
+	 * Pruned once no remaining frame was recorded with them
+	 */
+	struct FRecordedMesh
+	{
+		TArray<TWeakObjectPtr<const UBodySetup>> BodySetups;
+		FSimpleAnimDebugRoleSettings RoleSettings;
+
+		/** Serial of the newest frame recorded with this mesh */
+		int64 LastSerial = INDEX_NONE;
+	};
+
+	/** Location of a frame's data in Data */
+	struct FRecordedFrame
+	{
+		int64 Serial = 0;
+		double Time = 0.0;
+		float PositionPrecision = 0.f;
+		int32 Offset = 0;
+		int32 Size = 0;
+		int32 NumMeshes = 0;
+	};
+
+	TArray<FRegisteredMesh> Registered;
+	TArray<FRecordedMesh> RecordedMeshes;
+
+	/** Budget the buffers were allocated for, 0 if they need allocating */
+	int32 RecordingBudget = 0;
+
+	/** Most bytes RecordedMeshes can hold */
+	int64 RecordedMeshBudget = 0;
+
+	/** Ring buffer of frame data, each frame is every mesh followed by every body of each mesh */
+	TArray<uint8> Data;
+	int32 WriteOffset = 0;
+
+	/** Ring buffer of frames, oldest first */
+	TArray<FRecordedFrame> Frames;
+	int32 FirstFrame = 0;
+	int32 NumFrames = 0;
+
+	/** Serial of the next frame recorded, frames are numbered in the order they were recorded */
+	int64 NextFrameSerial = 0;
+
+	bool bRecording = false;
+	bool bResumeRecording = false;
+
+	/** Frame being drawn counted from the oldest frame, or INDEX_NONE if not playing back */
+	int32 PlaybackFrame = INDEX_NONE;
+	bool bPlaying = false;
+	float PlaybackRate = 1.f;
+	double PlaybackTime = 0.0;
+};
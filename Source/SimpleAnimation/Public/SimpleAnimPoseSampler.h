@@ -0,0 +1,53 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BoneContainer.h"
+
+class UAnimSequenceBase;
+class USkeleton;
+
+/** Space to return sampled bone transforms in */
+enum class ESimpleAnimPoseSpace : uint8
+{
+	/** Relative to the parent bone */
+	Local,
+	/** Relative to the skeleton root, i.e. the owning component */
+	Component,
+	/** Component space transformed by the supplied ComponentToWorld */
+	World,
+};
+
+/**
+ * Evaluates an animation once per time and gathers every bone from that single evaluation,
+ * instead of evaluating the full pose once per bone
+ *
+ * Bone indices are reference skeleton (raw bone) indices, which are always ordered parent-first
+ * Sampling is const and only reads the animation, so one sampler can be shared between threads
+ */
+struct SIMPLEANIMATION_API FSimpleAnimPoseSampler
+{
+	explicit FSimpleAnimPoseSampler(const UAnimSequenceBase* InAnimation);
+
+	bool IsValid() const { return Animation != nullptr && ParentIndices.Num() > 0; }
+	int32 GetNumBones() const { return ParentIndices.Num(); }
+	const TArray<int32>& GetParentIndices() const { return ParentIndices; }
+	const USkeleton* GetSkeleton() const { return Skeleton; }
+
+	/** Evaluate the local space transform of every bone at Time */
+	void SampleLocal(float Time, TArray<FTransform>& OutLocal) const;
+
+	/** Evaluate every bone at Time in the given space */
+	void Sample(float Time, ESimpleAnimPoseSpace Space, TArray<FTransform>& OutTransforms,
+		const FTransform& ComponentToWorld = FTransform::Identity) const;
+
+	/** Convert local space transforms to component space in place, parents must precede children */
+	static void LocalToComponent(const TArray<int32>& ParentIndices, TArray<FTransform>& InOutTransforms);
+
+private:
+	const UAnimSequenceBase* Animation = nullptr;
+	const USkeleton* Skeleton = nullptr;
+	FBoneContainer BoneContainer;
+	TArray<int32> ParentIndices;
+};
@@ -0,0 +1,48 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/** Profiling for every SimpleAnimation module, compiled out of shipping builds */
+#define SIMPLEANIM_PROFILING_ENABLED (!UE_BUILD_SHIPPING)
+
+#if SIMPLEANIM_PROFILING_ENABLED
+
+/** Enable with -trace=cpu,SimpleAnimation to see per-asset timings in Unreal Insights */
+UE_TRACE_CHANNEL_EXTERN(SimpleAnimationChannel, SIMPLEANIMATION_API);
+
+DECLARE_STATS_GROUP(TEXT("SimpleAnimation"), STATGROUP_SimpleAnimation, STATCAT_Advanced);
+
+// Totals since startup, editor operations span many frames
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Poses Evaluated"), STAT_SimpleAnim_PosesEvaluated, STATGROUP_SimpleAnimation, SIMPLEANIMATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Keys Written"), STAT_SimpleAnim_KeysWritten, STATGROUP_SimpleAnimation, SIMPLEANIMATION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Packages Dirtied"), STAT_SimpleAnim_PackagesDirtied, STATGROUP_SimpleAnimation, SIMPLEANIMATION_API);
+
+// Per frame
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Bodies Drawn"), STAT_SimpleAnim_BodiesDrawn, STATGROUP_SimpleAnimation, SIMPLEANIMATION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shapes Drawn"), STAT_SimpleAnim_ShapesDrawn, STATGROUP_SimpleAnimation, SIMPLEANIMATION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Lines Drawn"), STAT_SimpleAnim_LinesDrawn, STATGROUP_SimpleAnimation, SIMPLEANIMATION_API);
+
+/** CPU timer for the enclosing scope, shown in Unreal Insights and under 'stat SimpleAnimation' */
+#define SIMPLEANIM_SCOPE_CYCLE_COUNTER(Name) \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, SimpleAnimationChannel); \
+	DECLARE_SCOPE_CYCLE_COUNTER(TEXT(#Name), STAT_SimpleAnim_##Name, STATGROUP_SimpleAnimation)
+
+/** CPU timer for the enclosing scope named after an asset, for each iteration of a bulk operation */
+#define SIMPLEANIM_SCOPE_ASSET(Object) \
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(*GetNameSafe(Object), SimpleAnimationChannel)
+
+#define SIMPLEANIM_INC_STAT(Stat) INC_DWORD_STAT(Stat)
+#define SIMPLEANIM_INC_STAT_BY(Stat, Amount) INC_DWORD_STAT_BY(Stat, Amount)
+
+#else
+
+#define SIMPLEANIM_SCOPE_CYCLE_COUNTER(Name)
+#define SIMPLEANIM_SCOPE_ASSET(Object)
+#define SIMPLEANIM_INC_STAT(Stat)
+#define SIMPLEANIM_INC_STAT_BY(Stat, Amount)
+
+#endif
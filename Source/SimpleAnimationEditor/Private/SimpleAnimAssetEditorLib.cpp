@@ -6,13 +6,28 @@
 #include "AnimationBlueprintLibrary.h"
 #include "AnimationModifier.h"
 #include "AnimationModifiersAssetUserData.h"
+#include "AssetCompilingManager.h"
 #include "EditorReimportHandler.h"
-#include "PackageTools.h"
+#include "SimpleAnimAssetRegistryTags.h"
+#include "SimpleAnimCurveKeyBuilder.h"
+#include "SimpleAnimFingerprintCache.h"
+#include "SimpleAnimStats.h"
+#include "SimpleAnimStreamingIterator.h"
 #include "SimpleAnimationDeveloperSettings.h"
+#include "Animation/AnimData/IAnimationDataController.h"
 #include "AssetRegistry/AssetRegistryHelpers.h"
 #include "AssetRegistry/AssetRegistryModule.h"
 #include "EditorFramework/AssetImportData.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 #include "Factories/FbxAssetImportData.h"
+#include "Interfaces/ITargetPlatform.h"
+#include "Interfaces/ITargetPlatformManagerModule.h"
+#include "Misc/App.h"
+#include "Misc/AsyncTaskNotification.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/OutputDeviceRedirector.h"
+#include "Misc/ScopedSlowTask.h"
 #include "Misc/UObjectToken.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(SimpleAnimAssetEditorLib)
@@ -38,17 +53,79 @@ void USimpleAnimAssetEditorLib::EditorCastArrayChecked(TArray<UObject*> ArrayToC
 	}
 }
 
-void USimpleAnimAssetEditorLib::ApplyPreviewMesh(const TArray<UAnimSequence*>& Animations)
+TArray<FAssetData> USimpleAnimAssetEditorLib::GetAnimationAssetData(const TArray<FName>& PackagePaths, bool bRecursive)
 {
-	const USimpleAnimationDeveloperSettings* Settings = USimpleAnimationDeveloperSettings::Get();
-	USkeletalMesh* PreviewMesh = Settings->DefaultSkeletalMesh.LoadSynchronous();
-	if (!IsValid(PreviewMesh))
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(GetAnimationAssetData);
+
+	FARFilter Filter;
+	Filter.PackagePaths = PackagePaths;
+	Filter.bRecursivePaths = bRecursive;
+	Filter.ClassPaths.Add(UAnimSequence::StaticClass()->GetClassPathName());
+	Filter.bRecursiveClasses = true;
+
+	TArray<FAssetData> Assets;
+	IAssetRegistry::Get()->GetAssets(Filter, Assets);
+	return Assets;
+}
+
+namespace SimpleAnimAssetEditorLib
+{
+	static void ReportMissingPreviewMesh(const USimpleAnimationDeveloperSettings* Settings)
 	{
 		FMessageLog("AssetCheck")
 			.Error()
 			->AddToken(FUObjectToken::Create(Settings, LOCTEXT("NoDefaultSkeletalMesh", "No default skeletal mesh set in Simple Animation Settings.")))
 			->AddToken(FTextToken::Create(LOCTEXT("ApplyPreviewMeshError", "Please set a default skeletal mesh in the Simple Animation Settings.")));
 		FMessageLog("AssetCheck").Open();
+	}
+
+	/** @return True if the animation was saved before our registry tags existed, so it has to be loaded to be checked */
+	static bool IsMissingTag(const FAssetData& Asset, FName TagName)
+	{
+		return !Asset.FindTag(TagName);
+	}
+
+	/** Notes any error logged while in scope, modifiers log an error and return when they can't be applied */
+	struct FScopedErrorCapture final : public FOutputDevice
+	{
+		std::atomic<bool> bErrorLogged { false };
+
+		FScopedErrorCapture() { GLog->AddOutputDevice(this); }
+		virtual ~FScopedErrorCapture() override { GLog->RemoveOutputDevice(this); }
+
+		virtual bool CanBeUsedOnMultipleThreads() const override { return true; }
+		virtual void Serialize(const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category) override
+		{
+			const ELogVerbosity::Type Level = static_cast<ELogVerbosity::Type>(Verbosity & ELogVerbosity::VerbosityMask);
+			if (Level != ELogVerbosity::NoLogging && Level <= ELogVerbosity::Error)
+			{
+				bErrorLogged = true;
+			}
+		}
+	};
+
+	/** Shared by every step of ApplyPreviewMeshAsync, which runs across many frames */
+	struct FApplyPreviewMeshAsyncState
+	{
+		TArray<FSoftObjectPath> Paths;
+		int32 NextIndex = 0;
+		int32 BatchSize = 100;
+		int32 NumChanged = 0;
+		TSharedPtr<FStreamableHandle> MeshHandle;
+		TUniquePtr<FAsyncTaskNotification> Notification;
+		FSimpleAnimAsyncComplete OnComplete;
+	};
+}
+
+void USimpleAnimAssetEditorLib::ApplyPreviewMesh(const TArray<UAnimSequence*>& Animations)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(ApplyPreviewMesh);
+
+	const USimpleAnimationDeveloperSettings* Settings = USimpleAnimationDeveloperSettings::Get();
+	USkeletalMesh* PreviewMesh = Settings->DefaultSkeletalMesh.LoadSynchronous();
+	if (!IsValid(PreviewMesh))
+	{
+		SimpleAnimAssetEditorLib::ReportMissingPreviewMesh(Settings);
 		return;
 	}
 	
@@ -56,30 +133,156 @@ void USimpleAnimAssetEditorLib::ApplyPreviewMesh(const TArray<UAnimSequence*>& A
 	{
 		if (IsValid(Animation))
 		{
-			// USkeletalMesh* CurrentPreviewMesh = Animation->GetPreviewMesh();
-			if (Animation->GetPreviewMesh() != PreviewMesh)
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+			ApplyPreviewMesh_Internal(Animation, PreviewMesh);
+		}
+	}
+}
+
+int32 USimpleAnimAssetEditorLib::ApplyPreviewMeshAsync(const TArray<FAssetData>& Assets,
+	const FSimpleAnimAsyncComplete& OnComplete, int32 BatchSize)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(ApplyPreviewMeshAsync);
+
+	using FState = SimpleAnimAssetEditorLib::FApplyPreviewMeshAsyncState;
+
+	const USimpleAnimationDeveloperSettings* Settings = USimpleAnimationDeveloperSettings::Get();
+	if (Settings->DefaultSkeletalMesh.IsNull())
+	{
+		SimpleAnimAssetEditorLib::ReportMissingPreviewMesh(Settings);
+		OnComplete.ExecuteIfBound(0);
+		return 0;
+	}
+
+	const FString DesiredValue = FSimpleAnimAssetRegistryTags::ObjectToTag(Settings->DefaultSkeletalMesh.ToSoftObjectPath());
+	const TArray<FAssetData> Mismatched = FilterAssetsWithTagMismatch(Assets, FSimpleAnimAssetRegistryTags::PreviewMesh, DesiredValue);
+	if (Mismatched.Num() == 0)
+	{
+		OnComplete.ExecuteIfBound(0);
+		return 0;
+	}
+
+	const TSharedRef<FState> State = MakeShared<FState>();
+	State->BatchSize = FMath::Max(1, BatchSize);
+	State->OnComplete = OnComplete;
+	for (const FAssetData& Asset : Mismatched)
+	{
+		State->Paths.Add(Asset.GetSoftObjectPath());
+	}
+
+	FAsyncTaskNotificationConfig NotificationConfig;
+	NotificationConfig.TitleText = LOCTEXT("ApplyPreviewMeshAsync", "Applying preview mesh");
+	NotificationConfig.ProgressText = FText::Format(LOCTEXT("ApplyPreviewMeshAsync_Start", "Loading {0}"),
+		FText::FromString(Settings->DefaultSkeletalMesh.GetAssetName()));
+	NotificationConfig.bCanCancel = true;
+	NotificationConfig.bKeepOpenOnSuccess = true;
+	NotificationConfig.bKeepOpenOnFailure = true;
+	State->Notification = MakeUnique<FAsyncTaskNotification>(NotificationConfig);
+
+	// Each step requests the next once its batch has loaded, so only one batch is in flight at a time
+	// The pending load's delegate is what keeps the chain alive
+	TSharedRef<TFunction<void()>> NextBatch = MakeShared<TFunction<void()>>();
+	*NextBatch = [State, WeakNextBatch = TWeakPtr<TFunction<void()>>(NextBatch)]()
+	{
+		const TSoftObjectPtr<USkeletalMesh>& DefaultMesh = USimpleAnimationDeveloperSettings::Get()->DefaultSkeletalMesh;
+		USkeletalMesh* PreviewMesh = DefaultMesh.Get();
+		const bool bCancelled = State->Notification->GetPromptAction() == EAsyncTaskNotificationPromptAction::Cancel;
+		if (!PreviewMesh || bCancelled || State->NextIndex >= State->Paths.Num())
+		{
+			const FText Result = FText::Format(LOCTEXT("ApplyPreviewMeshAsync_Result", "Changed {0} of {1} animations"),
+				FText::AsNumber(State->NumChanged), FText::AsNumber(State->Paths.Num()));
+			if (!PreviewMesh)
+			{
+				State->Notification->SetComplete(LOCTEXT("ApplyPreviewMeshAsync_NoMesh", "Failed to load the default skeletal mesh"), Result, false);
+			}
+			else if (bCancelled)
 			{
-				Animation->SetPreviewMesh(PreviewMesh, true);
+				State->Notification->SetComplete(LOCTEXT("ApplyPreviewMeshAsync_Cancelled", "Cancelled applying preview mesh"), Result, false);
+			}
+			else
+			{
+				State->Notification->SetComplete(LOCTEXT("ApplyPreviewMeshAsync_Complete", "Applied preview mesh"), Result, true);
+			}
 
-				// ReSharper disable once CppExpressionWithoutSideEffects
-				Animation->MarkPackageDirty();
+			if (State->MeshHandle.IsValid())
+			{
+				State->MeshHandle->ReleaseHandle();
 			}
+			State->OnComplete.ExecuteIfBound(State->NumChanged);
+			return;
 		}
-	}
+
+		const int32 BatchStart = State->NextIndex;
+		const int32 BatchEnd = FMath::Min(BatchStart + State->BatchSize, State->Paths.Num());
+		State->NextIndex = BatchEnd;
+		State->Notification->SetProgressText(FText::Format(LOCTEXT("ApplyPreviewMeshAsync_Progress", "Animations {0} - {1} of {2}"),
+			FText::AsNumber(BatchStart + 1), FText::AsNumber(BatchEnd), FText::AsNumber(State->Paths.Num())));
+
+		TArray<FSoftObjectPath> BatchPaths(State->Paths.GetData() + BatchStart, BatchEnd - BatchStart);
+		UAssetManager::GetStreamableManager().RequestAsyncLoad(BatchPaths,
+			FStreamableDelegate::CreateLambda([State, NextBatch = WeakNextBatch.Pin(), BatchPaths, PreviewMesh = TWeakObjectPtr<USkeletalMesh>(PreviewMesh)]()
+			{
+				SIMPLEANIM_SCOPE_CYCLE_COUNTER(ApplyPreviewMeshAsync_Batch);
+
+				// Change the whole batch first, then dirty every changed package together once it's done
+				TSet<UPackage*> ChangedPackages;
+				for (const FSoftObjectPath& Path : BatchPaths)
+				{
+					UAnimSequence* Animation = Cast<UAnimSequence>(Path.ResolveObject());
+					if (!IsValid(Animation) || !PreviewMesh.IsValid())
+					{
+						continue;
+					}
+
+					constexpr bool bMarkDirty = false;
+					if (ApplyPreviewMesh_Internal(Animation, PreviewMesh.Get(), bMarkDirty))
+					{
+						State->NumChanged++;
+						ChangedPackages.Add(Animation->GetPackage());
+					}
+				}
+
+				for (UPackage* Package : ChangedPackages)
+				{
+					if (!Package->IsDirty())
+					{
+						// ReSharper disable once CppExpressionWithoutSideEffects
+						Package->MarkPackageDirty();
+						SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
+					}
+				}
+
+				(*NextBatch)();
+			}));
+	};
+
+	// The mesh is needed by every batch, so it is loaded first and kept until the end
+	State->MeshHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Settings->DefaultSkeletalMesh.ToSoftObjectPath(),
+		FStreamableDelegate::CreateLambda([NextBatch]()
+		{
+			(*NextBatch)();
+		}));
+
+	return Mismatched.Num();
 }
 
 void USimpleAnimAssetEditorLib::SetAnimRootLock(bool bLock, const TArray<UAnimSequence*>& Animations)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(SetAnimRootLock);
+
 	for (UAnimSequence* Animation : Animations)
 	{
 		if (IsValid(Animation))
 		{
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+
 			if (Animation->bForceRootLock != bLock)
 			{
 				Animation->bForceRootLock = bLock;
 
 				// ReSharper disable once CppExpressionWithoutSideEffects
 				Animation->MarkPackageDirty();
+				SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
 			}
 		}
 	}
@@ -88,16 +291,21 @@ void USimpleAnimAssetEditorLib::SetAnimRootLock(bool bLock, const TArray<UAnimSe
 void USimpleAnimAssetEditorLib::SetAnimEnableRootMotion(bool bEnableRootMotion,
 	const TArray<UAnimSequence*>& Animations)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(SetAnimEnableRootMotion);
+
 	for (UAnimSequence* Animation : Animations)
 	{
 		if (IsValid(Animation))
 		{
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+
 			if (Animation->bEnableRootMotion != bEnableRootMotion)
 			{
 				Animation->bEnableRootMotion = bEnableRootMotion;
 
 				// ReSharper disable once CppExpressionWithoutSideEffects
 				Animation->MarkPackageDirty();
+				SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
 			}
 		}
 	}
@@ -106,57 +314,184 @@ void USimpleAnimAssetEditorLib::SetAnimEnableRootMotion(bool bEnableRootMotion,
 void USimpleAnimAssetEditorLib::AddAnimFloatCurve(const TArray<UAnimSequence*>& Animations, FName CurveName,
 	float CurveValue, bool bMetaDataCurve)
 {
+	FSimpleAnimCurveSpec CurveSpec(CurveName);
+	CurveSpec.Keys.Emplace(0.f, CurveValue);
+	CurveSpec.bMetaDataCurve = bMetaDataCurve;
+	ApplyAnimFloatCurves(Animations, { CurveSpec });
+}
+
+void USimpleAnimAssetEditorLib::RemoveAnimFloatCurve(const TArray<UAnimSequence*>& Animations, FName CurveName)
+{
+	constexpr bool bRemove = true;
+	ApplyAnimFloatCurves(Animations, { FSimpleAnimCurveSpec(CurveName, bRemove) });
+}
+
+int32 USimpleAnimAssetEditorLib::ApplyAnimFloatCurves(const TArray<UAnimSequence*>& Animations,
+	const TArray<FSimpleAnimCurveSpec>& CurveSpecs)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(ApplyAnimFloatCurves);
+
+	int32 NumChanged = 0;
+	TArray<const FSimpleAnimCurveSpec*> ChangedSpecs;
 	for (UAnimSequence* Animation : Animations)
 	{
 		if (IsValid(Animation))
 		{
-			if (UAnimationBlueprintLibrary::DoesCurveExist(Animation, CurveName, ERawCurveTrackTypes::RCT_Float))
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+
+			// Find what would change before touching anything, so unchanged animations never open a bracket
+			ChangedSpecs.Reset();
+			for (const FSimpleAnimCurveSpec& CurveSpec : CurveSpecs)
+			{
+				FAnimationCurveIdentifier CurveId;
+				const FFloatCurve* Curve = GetFloatCurveId(Animation, CurveSpec.CurveName, false, CurveId) ?
+					Animation->GetDataModel()->FindFloatCurve(CurveId) : nullptr;
+
+				const bool bChanged = CurveSpec.bRemove ? Curve != nullptr : !Curve ||
+					Curve->GetCurveTypeFlag(AACF_Metadata) != CurveSpec.bMetaDataCurve ||
+					Curve->FloatCurve.GetConstRefOfKeys() != CurveSpec.Keys;
+
+				if (bChanged)
+				{
+					ChangedSpecs.Add(&CurveSpec);
+				}
+			}
+
+			if (ChangedSpecs.Num() == 0)
 			{
-				// If the curve already exists, remove it first
-				UAnimationBlueprintLibrary::RemoveCurve(Animation, CurveName);
+				continue;
+			}
+
+			{
+				constexpr bool bShouldTransact = false;
+				IAnimationDataController& Controller = Animation->GetController();
+				IAnimationDataController::FScopedBracket Bracket(Controller,
+					LOCTEXT("ApplyAnimFloatCurves_Bracket", "Applying float curves"), bShouldTransact);
+
+				for (const FSimpleAnimCurveSpec* CurveSpec : ChangedSpecs)
+				{
+					FAnimationCurveIdentifier CurveId;
+					if (!GetFloatCurveId(Animation, CurveSpec->CurveName, !CurveSpec->bRemove, CurveId))
+					{
+						continue;
+					}
+
+					// The same curve may be listed more than once
+					const bool bExists = Animation->GetDataModel()->FindFloatCurve(CurveId) != nullptr;
+					if (CurveSpec->bRemove)
+					{
+						if (bExists)
+						{
+							Controller.RemoveCurve(CurveId, bShouldTransact);
+						}
+						continue;
+					}
+
+					const int32 CurveFlags = CurveSpec->bMetaDataCurve ? AACF_Metadata : AACF_DefaultCurve;
+					if (bExists)
+					{
+						Controller.SetCurveFlags(CurveId, CurveFlags, bShouldTransact);
+					}
+					else
+					{
+						Controller.AddCurve(CurveId, CurveFlags, bShouldTransact);
+					}
+					Controller.SetCurveKeys(CurveId, CurveSpec->Keys, bShouldTransact);
+					SIMPLEANIM_INC_STAT_BY(STAT_SimpleAnim_KeysWritten, CurveSpec->Keys.Num());
+				}
 			}
-			
-			UAnimationBlueprintLibrary::AddCurve(Animation, CurveName, ERawCurveTrackTypes::RCT_Float, bMetaDataCurve);
-			UAnimationBlueprintLibrary::AddFloatCurveKey(Animation, CurveName, 0.f, CurveValue);
 
 			// ReSharper disable once CppExpressionWithoutSideEffects
 			Animation->MarkPackageDirty();
+			SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
+			NumChanged++;
 		}
 	}
+
+	return NumChanged;
 }
 
-void USimpleAnimAssetEditorLib::RemoveAnimFloatCurve(const TArray<UAnimSequence*>& Animations, FName CurveName)
+TArray<FSimpleAnimCurveReduction> USimpleAnimAssetEditorLib::ReduceAnimCurveKeys(const TArray<UAnimSequence*>& Animations,
+	float Tolerance)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(ReduceAnimCurveKeys);
+
+	TArray<FSimpleAnimCurveReduction> Reductions;
 	for (UAnimSequence* Animation : Animations)
 	{
 		if (IsValid(Animation))
 		{
-			if (UAnimationBlueprintLibrary::DoesCurveExist(Animation, CurveName, ERawCurveTrackTypes::RCT_Float))
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+
+			FSimpleAnimCurveReduction& Reduction = Reductions.AddDefaulted_GetRef();
+			Reduction.Animation = Animation;
+
+			// Reduce every curve before changing any of them, so untouched animations never open a bracket
+			TArray<TPair<FAnimationCurveIdentifier, TArray<FRichCurveKey>>> ReducedCurves;
+			for (const FFloatCurve& Curve : Animation->GetDataModel()->GetFloatCurves())
 			{
-				// If the curve already exists, remove it first
-				UAnimationBlueprintLibrary::RemoveCurve(Animation, CurveName);
+				TArray<FRichCurveKey> Keys = Curve.FloatCurve.GetConstRefOfKeys();
+				Reduction.NumKeysBefore += Keys.Num();
+				FSimpleAnimCurveKeyBuilder::ReduceKeys(Keys, Tolerance);
+				Reduction.NumKeysAfter += Keys.Num();
 
-				// ReSharper disable once CppExpressionWithoutSideEffects
-				Animation->MarkPackageDirty();
+				if (Keys.Num() != Curve.FloatCurve.GetNumKeys())
+				{
+#if ENGINE_MINOR_VERSION >= 3
+					FAnimationCurveIdentifier CurveId(Curve.GetName(), ERawCurveTrackTypes::RCT_Float);
+#else
+					FAnimationCurveIdentifier CurveId(Curve.Name, ERawCurveTrackTypes::RCT_Float);
+#endif
+					ReducedCurves.Emplace(MoveTemp(CurveId), MoveTemp(Keys));
+				}
 			}
+
+			Reduction.NumCurvesReduced = ReducedCurves.Num();
+			Reduction.EstimatedBytesSaved = (Reduction.NumKeysBefore - Reduction.NumKeysAfter) * static_cast<int32>(sizeof(FRichCurveKey));
+			if (ReducedCurves.Num() == 0)
+			{
+				continue;
+			}
+
+			{
+				constexpr bool bShouldTransact = false;
+				IAnimationDataController::FScopedBracket Bracket(Animation->GetController(),
+					LOCTEXT("ReduceAnimCurveKeys_Bracket", "Reducing curve keys"), bShouldTransact);
+
+				for (const TPair<FAnimationCurveIdentifier, TArray<FRichCurveKey>>& ReducedCurve : ReducedCurves)
+				{
+					Animation->GetController().SetCurveKeys(ReducedCurve.Key, ReducedCurve.Value, bShouldTransact);
+				}
+			}
+
+			// ReSharper disable once CppExpressionWithoutSideEffects
+			Animation->MarkPackageDirty();
+			SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
 		}
 	}
+
+	return Reductions;
 }
 
 TArray<UAnimSequence*> USimpleAnimAssetEditorLib::SetCompressionTypeForAnimations(const TArray<UAnimSequence*>& Animations,
 	UAnimCurveCompressionSettings* CurveCompressionSettings)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(SetCompressionTypeForAnimations);
+
 	TArray<UAnimSequence*> ChangedAnimations;
 	for (UAnimSequence* Animation : Animations)
 	{
 		if (IsValid(Animation))
 		{
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+
 			if (Animation->CurveCompressionSettings != CurveCompressionSettings)
 			{
 				Animation->CurveCompressionSettings = CurveCompressionSettings;
 
 				// ReSharper disable once CppExpressionWithoutSideEffects
 				Animation->MarkPackageDirty();
+				SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
 
 				ChangedAnimations.AddUnique(Animation);
 			}
@@ -168,19 +503,277 @@ TArray<UAnimSequence*> USimpleAnimAssetEditorLib::SetCompressionTypeForAnimation
 
 void USimpleAnimAssetEditorLib::CompressAnimations(const TArray<UAnimSequence*>& Animations)
 {
+	CompressAnimationsAsync(Animations, {});
+}
+
+TArray<UAnimSequence*> USimpleAnimAssetEditorLib::CompressAnimationsAsync(const TArray<UAnimSequence*>& Animations,
+	const TArray<FString>& TargetPlatformNames, int32 MaxConcurrent, float TimeoutSeconds, bool bShowProgress)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(CompressAnimationsAsync);
+
+	TArray<UAnimSequence*> FailedAnimations;
+
+	ITargetPlatformManagerModule& TargetPlatformManager = GetTargetPlatformManagerRef();
+	const ITargetPlatform* RunningPlatform = TargetPlatformManager.GetRunningTargetPlatform();
+	if (!RunningPlatform)
+	{
+		return FailedAnimations;
+	}
+
+	FMessageLog MsgLog("AssetCheck");
+
+	TArray<const ITargetPlatform*> Platforms = { RunningPlatform };
+	for (const FString& PlatformName : TargetPlatformNames)
+	{
+		if (const ITargetPlatform* Platform = TargetPlatformManager.FindTargetPlatform(PlatformName))
+		{
+			Platforms.AddUnique(Platform);
+		}
+		else
+		{
+			MsgLog.Warning(FText::Format(LOCTEXT("CompressAnimations_UnknownPlatform", "Unknown target platform {0}, it will be skipped"),
+				FText::FromString(PlatformName)));
+		}
+	}
+
+	struct FCompressionTask
+	{
+		UAnimSequence* Animation;
+		const ITargetPlatform* Platform;
+		double StartTime;
+	};
+
+	static const FName FingerprintOperation = TEXT("CompressAnimations");
+	TArray<FString> PlatformNames;
+	for (const ITargetPlatform* Platform : Platforms)
+	{
+		PlatformNames.Add(Platform->PlatformName());
+	}
+	PlatformNames.Sort();
+
+	// An engine upgrade can change the codecs without changing the animation or its settings
+	const uint64 ParamsHash = FSimpleAnimFingerprintCache::HashString(FString::Join(PlatformNames, TEXT(",")) + TEXT("|") +
+		FEngineVersion::Current().ToString());
+
+	// The derived data key of each platform covers everything the compressed result depends on, codec versions included
+	auto HashDerivedDataKeys = [&Platforms, ParamsHash](UAnimSequence* Animation)
+	{
+		uint64 Hash = ParamsHash;
+		for (const ITargetPlatform* Platform : Platforms)
+		{
+#if ENGINE_MINOR_VERSION >= 2
+			Hash = FSimpleAnimFingerprintCache::HashString(Animation->CreateDerivedDataKeyString(Platform), Hash);
+#else
+			Hash = FSimpleAnimFingerprintCache::HashString(Animation->GetDDCCacheKeySuffix(false, Platform), Hash);
+#endif
+		}
+		return Hash;
+	};
+
+	// One task per animation per platform, and how many of each animation's tasks are still outstanding
+	TArray<FCompressionTask> PendingTasks;
+	TMap<UAnimSequence*, int32> RemainingTasks;
+	TMap<UAnimSequence*, uint64> AnimParamsHashes;
+	int32 NumUpToDate = 0;
 	for (UAnimSequence* Animation : Animations)
 	{
-		if (IsValid(Animation) && Animation->GetOutermost() != GetTransientPackage())
+		if (IsValid(Animation) && Animation->GetOutermost() != GetTransientPackage() && !RemainingTasks.Contains(Animation))
 		{
-			if (const ITargetPlatform* RunningPlatform = GetTargetPlatformManagerRef().GetRunningTargetPlatform())
+			const uint64 AnimParamsHash = HashDerivedDataKeys(Animation);
+			if (FSimpleAnimFingerprintCache::IsUpToDate(Animation, FingerprintOperation, AnimParamsHash))
 			{
-				Animation->CacheDerivedDataForPlatform(RunningPlatform);
-		
-				// ReSharper disable once CppExpressionWithoutSideEffects
-				Animation->MarkPackageDirty();
+				NumUpToDate++;
+				continue;
 			}
+
+			AnimParamsHashes.Add(Animation, AnimParamsHash);
+			RemainingTasks.Add(Animation, Platforms.Num());
+			for (const ITargetPlatform* Platform : Platforms)
+			{
+				PendingTasks.Add({ Animation, Platform, 0.0 });
+			}
+		}
+	}
+
+	if (NumUpToDate > 0)
+	{
+		MsgLog.Info(FText::Format(LOCTEXT("CompressAnimations_UpToDate", "Skipped {0} animations that haven't changed since they were last compressed"),
+			FText::AsNumber(NumUpToDate)));
+	}
+
+	if (PendingTasks.Num() == 0)
+	{
+		return FailedAnimations;
+	}
+
+	FScopedSlowTask SlowTask(PendingTasks.Num(), LOCTEXT("CompressAnimations", "Compressing animations..."), bShowProgress);
+	if (bShowProgress)
+	{
+		SlowTask.MakeDialog(true);
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	MaxConcurrent = FMath::Max(1, MaxConcurrent);
+
+	// The running platform compresses into the animation's own data, so it never goes through the cooked data cache,
+	// which would have it release and rebuild the data the editor is using
+	auto BeginTask = [RunningPlatform](FCompressionTask& Task)
+	{
+		Task.StartTime = FPlatformTime::Seconds();
+		if (Task.Platform != RunningPlatform)
+		{
+			Task.Animation->BeginCacheForCookedPlatformData(Task.Platform);
+		}
+		else
+		{
+#if ENGINE_MINOR_VERSION >= 2
+			Task.Animation->BeginCacheDerivedDataForCurrentPlatform();
+#else
+			Task.Animation->CacheDerivedDataForPlatform(RunningPlatform);
+#endif
+		}
+	};
+
+	auto IsTaskComplete = [RunningPlatform](const FCompressionTask& Task)
+	{
+		if (Task.Platform != RunningPlatform)
+		{
+			return Task.Animation->IsCachedCookedPlatformDataLoaded(Task.Platform);
+		}
+#if ENGINE_MINOR_VERSION >= 2
+		return !Task.Animation->IsCompiling();
+#else
+		return true;
+#endif
+	};
+
+	// Cooked data can't be released while a task is still writing it
+	auto StopTask = [&](const FCompressionTask& Task)
+	{
+#if ENGINE_MINOR_VERSION >= 2
+		if (!Task.Animation->TryCancelAsyncTasks())
+		{
+			Task.Animation->FinishAsyncTasks();
+		}
+#else
+		while (!IsTaskComplete(Task))
+		{
+			FAssetCompilingManager::Get().ProcessAsyncTasks(true);
+			FPlatformProcess::Sleep(0.005f);
+		}
+#endif
+	};
+
+	auto ReportFailure = [&MsgLog, &FailedAnimations](const FCompressionTask& Task, const FText& Reason)
+	{
+		FailedAnimations.AddUnique(Task.Animation);
+		MsgLog.Error()
+			->AddToken(FUObjectToken::Create(Task.Animation))
+			->AddToken(FTextToken::Create(FText::Format(Reason, FText::FromString(Task.Platform->PlatformName()))));
+	};
+
+	TArray<FCompressionTask> InFlightTasks;
+	InFlightTasks.Reserve(MaxConcurrent);
+	int32 NextTask = 0;
+	bool bCancelled = false;
+	while (InFlightTasks.Num() > 0 || (!bCancelled && NextTask < PendingTasks.Num()))
+	{
+		bCancelled |= SlowTask.ShouldCancel();
+
+		// Keep the scheduler topped up, compression happens on worker threads
+		while (!bCancelled && InFlightTasks.Num() < MaxConcurrent && NextTask < PendingTasks.Num())
+		{
+			const FCompressionTask& PendingTask = PendingTasks[NextTask++];
+			if (FailedAnimations.Contains(PendingTask.Animation))
+			{
+				// Already failed for another platform
+				SlowTask.EnterProgressFrame(1.f);
+				continue;
+			}
+			BeginTask(InFlightTasks.Add_GetRef(PendingTask));
+		}
+
+		// Let finished compression tasks complete on the game thread
+		FAssetCompilingManager::Get().ProcessAsyncTasks(true);
+
+		for (int32 TaskIndex = InFlightTasks.Num() - 1; TaskIndex >= 0; --TaskIndex)
+		{
+			const FCompressionTask& Task = InFlightTasks[TaskIndex];
+			const bool bComplete = IsTaskComplete(Task);
+			const bool bAbandoned = !bComplete && FailedAnimations.Contains(Task.Animation);
+			const bool bTimedOut = !bComplete && !bAbandoned && FPlatformTime::Seconds() - Task.StartTime > TimeoutSeconds;
+			if (!bComplete && !bAbandoned && !bTimedOut)
+			{
+				continue;
+			}
+
+			if (bTimedOut)
+			{
+				ReportFailure(Task, LOCTEXT("CompressAnimations_TimedOut", "Timed out compressing for {0}"));
+			}
+			else if (bComplete && Task.Platform == RunningPlatform && !Task.Animation->IsCompressedDataValid())
+			{
+				ReportFailure(Task, LOCTEXT("CompressAnimations_Invalid", "Failed to compress for {0}"));
+			}
+
+			// Cancels every task of the animation, the others are abandoned as they're reached
+			if (!bComplete)
+			{
+				StopTask(Task);
+			}
+
+			// The result is in the DDC now, so release our copy
+			if (Task.Platform != RunningPlatform)
+			{
+				Task.Animation->ClearCachedCookedPlatformData(Task.Platform);
+			}
+			RemainingTasks[Task.Animation]--;
+			InFlightTasks.RemoveAtSwap(TaskIndex);
+			SlowTask.EnterProgressFrame(1.f);
+		}
+
+		if (InFlightTasks.Num() > 0)
+		{
+			FPlatformProcess::Sleep(0.005f);
+		}
+	}
+
+	int32 NumCompressed = 0;
+	for (const TPair<UAnimSequence*, int32>& Remaining : RemainingTasks)
+	{
+		UAnimSequence* Animation = Remaining.Key;
+		if (Remaining.Value > 0 || FailedAnimations.Contains(Animation))
+		{
+			continue;
 		}
+
+		// ReSharper disable once CppExpressionWithoutSideEffects
+		Animation->MarkPackageDirty();
+		SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
+		FSimpleAnimFingerprintCache::MarkUpToDate(Animation, FingerprintOperation, AnimParamsHashes[Animation]);
+		NumCompressed++;
+	}
+	FSimpleAnimFingerprintCache::Flush();
+
+	const FText Summary = FText::Format(
+		LOCTEXT("CompressAnimations_Summary", "Compressed {0} of {1} animations for {2} platform(s) in {3} seconds, {4} failed"),
+		FText::AsNumber(NumCompressed), FText::AsNumber(RemainingTasks.Num()), FText::AsNumber(Platforms.Num()),
+		FText::AsNumber(FMath::RoundToInt(FPlatformTime::Seconds() - StartTime)), FText::AsNumber(FailedAnimations.Num()));
+	if (bCancelled)
+	{
+		MsgLog.Warning(FText::Format(LOCTEXT("CompressAnimations_Cancelled", "Cancelled. {0}"), Summary));
+	}
+	else
+	{
+		MsgLog.Info(Summary);
 	}
+	
+	if (FailedAnimations.Num() > 0 || bCancelled)
+	{
+		MsgLog.Open();
+	}
+
+	return FailedAnimations;
 }
 
 void USimpleAnimAssetEditorLib::CloseAllAnimationEditors(UAnimSequence* Animation)
@@ -191,59 +784,85 @@ void USimpleAnimAssetEditorLib::CloseAllAnimationEditors(UAnimSequence* Animatio
 
 void USimpleAnimAssetEditorLib::RemoveAllAnimCurves(const TArray<UAnimSequence*>& Animations)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(RemoveAllAnimCurves);
+
 	for (UAnimSequence* Animation : Animations)
 	{
 		if (IsValid(Animation))
 		{
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+
 			UAnimationBlueprintLibrary::RemoveAllCurveData(Animation);
 			
 			// ReSharper disable once CppExpressionWithoutSideEffects
 			Animation->MarkPackageDirty();
+			SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
 		}
 	}
 }
 
 void USimpleAnimAssetEditorLib::RemoveAllAnimNotifies(const TArray<UAnimSequence*>& Animations)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(RemoveAllAnimNotifies);
+
 	for (UAnimSequence* Animation : Animations)
 	{
 		if (IsValid(Animation))
 		{
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+
 			UAnimationBlueprintLibrary::RemoveAllAnimationNotifyTracks(Animation);
 
 			// ReSharper disable once CppExpressionWithoutSideEffects
 			Animation->MarkPackageDirty();
+			SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
 		}
 	}
 }
 
 void USimpleAnimAssetEditorLib::RemoveAllAnimModifiers(const TArray<UAnimSequence*>& Animations)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(RemoveAllAnimModifiers);
+
 	int32 Removed = 0;
 	for (UAnimSequence* Animation : Animations)
 	{
 		if (IsValid(Animation))
 		{
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+
 			CloseAllAnimationEditors(Animation);
 
-			Removed += RemoveAllAnimModifiers_Internal(Animation);
-			if (Removed > 0)
+			const int32 NumRemoved = RemoveAllAnimModifiers_Internal(Animation);
+			Removed += NumRemoved;
+			if (NumRemoved > 0)
 			{
 				// ReSharper disable once CppExpressionWithoutSideEffects
 				Animation->MarkPackageDirty();
+				SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
 			}
 		}
 	}
 
-	FMessageDialog Dialog;
 	const FText DialogMsg = FText::FromString(FString::Printf(
 		TEXT("Removed %d modifiers"), Removed));
+
+	// A modal dialog would block the build machine forever
+	if (FApp::IsUnattended() || IsRunningCommandlet())
+	{
+		FMessageLog("AssetCheck").Info(DialogMsg);
+		return;
+	}
+
+	FMessageDialog Dialog;
 	Dialog.Open(EAppMsgType::Ok, DialogMsg);
 }
 
 void USimpleAnimAssetEditorLib::AddAnimModifiers(const TArray<UAnimSequence*>& Animations,
 	const TArray<TSubclassOf<UAnimationModifier>>& Modifiers)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(AddAnimModifiers);
+
 	if (Animations.Num() == 0 || Modifiers.Num() == 0)
 	{
 		return;
@@ -255,66 +874,146 @@ void USimpleAnimAssetEditorLib::AddAnimModifiers(const TArray<UAnimSequence*>& A
 		UAnimSequence* Animation;
 	};
 
+	static const FName FingerprintOperation = TEXT("AddAnimModifiers");
+	const uint64 ParamsHash = HashAnimModifiers(Modifiers);
+
 	TArray<FAssetDataPair> AssetUserData;
 	for (UAnimSequence* Animation : Animations)
 	{
+		if (FSimpleAnimFingerprintCache::IsUpToDate(Animation, FingerprintOperation, ParamsHash))
+		{
+			continue;
+		}
+
 		CloseAllAnimationEditors(Animation);
-		
-		UAnimationModifiersAssetUserData* UserData = Animation->GetAssetUserData<UAnimationModifiersAssetUserData>();
-		if (!UserData)
+		AssetUserData.Add({ GetOrCreateModifiersUserData(Animation), Animation });
+	}
+
+	// Animations with a modifier that failed are applied again next time
+	TSet<UAnimSequence*> FailedAnimations;
+	{
+		// For each added modifier create add a new instance to each of the user data entries, using the one(s) set up in the window as template(s)
+		UE::Anim::FApplyModifiersScope Scope;
+		for (const TSubclassOf<UAnimationModifier>& Modifier : Modifiers)
 		{
-			UserData = NewObject<UAnimationModifiersAssetUserData>(Animation, UAnimationModifiersAssetUserData::StaticClass());
-			checkf(UserData, TEXT("Unable to instantiate AssetUserData class"));
-			UserData->SetFlags(RF_Transactional);
-			Animation->AddAssetUserData(UserData);
+			for (const FAssetDataPair& UserDataPair : AssetUserData)
+			{
+				if (!ApplyAnimModifier_Internal(UserDataPair.UserData, UserDataPair.Animation, Modifier))
+				{
+					FailedAnimations.Add(UserDataPair.Animation);
+				}
+			}
+		}
+	}
 
-			// ReSharper disable once CppExpressionWithoutSideEffects
-			Animation->MarkPackageDirty();
+	for (const FAssetDataPair& UserDataPair : AssetUserData)
+	{
+		if (!FailedAnimations.Contains(UserDataPair.Animation))
+		{
+			FSimpleAnimFingerprintCache::MarkUpToDate(UserDataPair.Animation, FingerprintOperation, ParamsHash);
 		}
-		
-		AssetUserData.Add({ UserData, Animation });
 	}
+	FSimpleAnimFingerprintCache::Flush();
+}
+
+int32 USimpleAnimAssetEditorLib::AddAnimModifiersBatched(const TArray<UAnimSequence*>& Animations,
+	const TArray<TSubclassOf<UAnimationModifier>>& Modifiers, int32 ChunkSize)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(AddAnimModifiersBatched);
+
+	if (Animations.Num() == 0 || Modifiers.Num() == 0)
+	{
+		return 0;
+	}
+
+	ChunkSize = FMath::Max(1, ChunkSize);
+
+	FScopedSlowTask SlowTask(Animations.Num(), LOCTEXT("AddAnimModifiersBatched", "Applying animation modifiers..."));
+	SlowTask.MakeDialog(true);
+
+	static const FName FingerprintOperation = TEXT("AddAnimModifiers");
+	const uint64 ParamsHash = HashAnimModifiers(Modifiers);
 
-	// For each added modifier create add a new instance to each of the user data entries, using the one(s) set up in the window as template(s)
 	UE::Anim::FApplyModifiersScope Scope;
-	for (const TSubclassOf<UAnimationModifier>& Modifier : Modifiers)
+	int32 NumProcessed = 0;
+	for (int32 ChunkStart = 0; ChunkStart < Animations.Num(); ChunkStart += ChunkSize)
 	{
-		for (const FAssetDataPair& UserDataPair : AssetUserData)
+		if (SlowTask.ShouldCancel())
 		{
-			UAnimationModifiersAssetUserData* UserData = UserDataPair.UserData;
-			UAnimationModifier* const* ExistingModifier = UserData->GetAnimationModifierInstances().FindByPredicate(
-				[Modifier](const UAnimationModifier* TestModifier)
-				{
-					return Modifier == TestModifier->GetClass();
-				});
-			const bool bAlreadyContainsModifier = ExistingModifier != nullptr;
+			break;
+		}
+
+		// Progress and the UI only refresh once per chunk, not once per animation
+		const int32 ChunkEnd = FMath::Min(ChunkStart + ChunkSize, Animations.Num());
+		SlowTask.EnterProgressFrame(ChunkEnd - ChunkStart, FText::Format(
+			LOCTEXT("AddAnimModifiersBatched_Progress", "Applying animation modifiers {0} - {1} of {2}"),
+			FText::AsNumber(ChunkStart + 1), FText::AsNumber(ChunkEnd), FText::AsNumber(Animations.Num())));
 
-			if (!bAlreadyContainsModifier)
+		for (int32 AnimIndex = ChunkStart; AnimIndex < ChunkEnd; ++AnimIndex)
+		{
+			UAnimSequence* Animation = Animations[AnimIndex];
+			if (!IsValid(Animation))
 			{
-				UAnimationModifier* Processor = CreateModifierInstance(UserData, Modifier, Modifier.GetDefaultObject());
-				const TArray<UAnimationModifier*>& Instances = UserData->GetAnimationModifierInstances();
-				TArray<UAnimationModifier*>& MutableInstances = const_cast<TArray<UAnimationModifier*>&>(Instances);
-				MutableInstances.Add(Processor);
-				Processor->ApplyToAnimationSequence(UserDataPair.Animation);
+				continue;
 			}
-			else
+
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+
+			if (FSimpleAnimFingerprintCache::IsUpToDate(Animation, FingerprintOperation, ParamsHash))
 			{
-				// Reapply the existing modifier instead of adding a new one
-				// We cannot get a non-const because Epic protected and used friend classes
-				const UAnimationModifier* MutableModifier = const_cast<UAnimationModifier*>(*ExistingModifier);
-				MutableModifier->ApplyToAnimationSequence(UserDataPair.Animation);
+				NumProcessed++;
+				continue;
 			}
+
+			CloseAllAnimationEditors(Animation);
+			UAnimationModifiersAssetUserData* UserData = GetOrCreateModifiersUserData(Animation);
+
+			bool bApplied = true;
+			{
+				// Each modifier opens its own bracket, nesting them inside ours means the model only broadcasts, and the
+				// animation only recompresses, once the outermost bracket closes after the last modifier
+				constexpr bool bShouldTransact = false;
+				IAnimationDataController::FScopedBracket Bracket(Animation->GetController(),
+					LOCTEXT("AddAnimModifiersBatched_Bracket", "Applying animation modifiers"), bShouldTransact);
+
+				for (const TSubclassOf<UAnimationModifier>& Modifier : Modifiers)
+				{
+					bApplied &= ApplyAnimModifier_Internal(UserData, Animation, Modifier);
+				}
+			}
+
+			// Applied again next time if any modifier failed
+			if (bApplied)
+			{
+				FSimpleAnimFingerprintCache::MarkUpToDate(Animation, FingerprintOperation, ParamsHash);
+			}
+			NumProcessed++;
 		}
 	}
+	FSimpleAnimFingerprintCache::Flush();
+
+	return NumProcessed;
 }
 
 void USimpleAnimAssetEditorLib::SetImportRotation(const TArray<UAnimSequence*>& Animations, FRotator Rotation,
 	bool bReimport)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(SetImportRotation);
+
+	static const FName FingerprintOperation = TEXT("SetImportRotation");
+	const uint64 ParamsHash = FSimpleAnimFingerprintCache::HashString(Rotation.ToString() + (bReimport ? TEXT("|Reimport") : TEXT("")));
+
 	for (UAnimSequence* Animation : Animations)
 	{
 		if (IsValid(Animation))
 		{
+			SIMPLEANIM_SCOPE_ASSET(Animation);
+
+			if (FSimpleAnimFingerprintCache::IsUpToDate(Animation, FingerprintOperation, ParamsHash))
+			{
+				continue;
+			}
+
 			TObjectPtr<UAssetImportData>& BaseImportData = Animation->AssetImportData;
 			if (!IsValid(BaseImportData))
 			{
@@ -337,11 +1036,170 @@ void USimpleAnimAssetEditorLib::SetImportRotation(const TArray<UAnimSequence*>&
 			{
 				// ReSharper disable once CppExpressionWithoutSideEffects
 				Animation->MarkPackageDirty();
+				SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
+			}
+
+			FSimpleAnimFingerprintCache::MarkUpToDate(Animation, FingerprintOperation, ParamsHash);
+		}
+	}
+	FSimpleAnimFingerprintCache::Flush();
+}
+
+int32 USimpleAnimAssetEditorLib::ApplyPreviewMesh_Registry(const TArray<FAssetData>& Assets)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(ApplyPreviewMesh_Registry);
+
+	const USimpleAnimationDeveloperSettings* Settings = USimpleAnimationDeveloperSettings::Get();
+	if (Settings->DefaultSkeletalMesh.IsNull())
+	{
+		SimpleAnimAssetEditorLib::ReportMissingPreviewMesh(Settings);
+		return 0;
+	}
+
+	const FString DesiredValue = FSimpleAnimAssetRegistryTags::ObjectToTag(Settings->DefaultSkeletalMesh.ToSoftObjectPath());
+	const TArray<UAnimSequence*> Animations = LoadAnimationsWithTagMismatch(Assets, FSimpleAnimAssetRegistryTags::PreviewMesh, DesiredValue);
+	if (Animations.Num() > 0)
+	{
+		ApplyPreviewMesh(Animations);
+	}
+	return Animations.Num();
+}
+
+int32 USimpleAnimAssetEditorLib::SetAnimRootLock_Registry(bool bLock, const TArray<FAssetData>& Assets)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(SetAnimRootLock_Registry);
+
+	const TArray<UAnimSequence*> Animations = LoadAnimationsWithTagMismatch(Assets, FSimpleAnimAssetRegistryTags::ForceRootLock,
+		FSimpleAnimAssetRegistryTags::BoolToTag(bLock));
+	SetAnimRootLock(bLock, Animations);
+	return Animations.Num();
+}
+
+int32 USimpleAnimAssetEditorLib::SetAnimEnableRootMotion_Registry(bool bEnableRootMotion, const TArray<FAssetData>& Assets)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(SetAnimEnableRootMotion_Registry);
+
+	const TArray<UAnimSequence*> Animations = LoadAnimationsWithTagMismatch(Assets, FSimpleAnimAssetRegistryTags::EnableRootMotion,
+		FSimpleAnimAssetRegistryTags::BoolToTag(bEnableRootMotion));
+	SetAnimEnableRootMotion(bEnableRootMotion, Animations);
+	return Animations.Num();
+}
+
+TArray<UAnimSequence*> USimpleAnimAssetEditorLib::SetCompressionTypeForAnimations_Registry(const TArray<FAssetData>& Assets,
+	UAnimCurveCompressionSettings* CurveCompressionSettings)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(SetCompressionTypeForAnimations_Registry);
+
+	const TArray<UAnimSequence*> Animations = LoadAnimationsWithTagMismatch(Assets, FSimpleAnimAssetRegistryTags::CurveCompressionSettings,
+		FSimpleAnimAssetRegistryTags::ObjectToTag(FSoftObjectPath(CurveCompressionSettings)));
+	return SetCompressionTypeForAnimations(Animations, CurveCompressionSettings);
+}
+
+int32 USimpleAnimAssetEditorLib::AddMissingAssetRegistryTags(const TArray<FAssetData>& Assets)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(AddMissingAssetRegistryTags);
+
+	// Every tag is written together, so one missing means they all are
+	int32 NumDirtied = 0;
+	for (const FAssetData& Asset : Assets)
+	{
+		if (!Asset.IsValid() || !Asset.IsInstanceOf(UAnimSequence::StaticClass()) ||
+			!SimpleAnimAssetEditorLib::IsMissingTag(Asset, FSimpleAnimAssetRegistryTags::ForceRootLock))
+		{
+			continue;
+		}
+
+		UAnimSequence* Animation = Cast<UAnimSequence>(Asset.GetAsset());
+		if (IsValid(Animation) && !Animation->GetPackage()->IsDirty())
+		{
+			// ReSharper disable once CppExpressionWithoutSideEffects
+			Animation->MarkPackageDirty();
+			SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
+			NumDirtied++;
+		}
+	}
+	return NumDirtied;
+}
+
+bool USimpleAnimAssetEditorLib::RunBulkOperation(const TArray<UAnimSequence*>& Animations,
+	const FSimpleAnimBulkSettings& Settings)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(RunBulkOperation);
+
+	switch (Settings.Operation)
+	{
+	case ESimpleAnimBulkOperation::ApplyPreviewMesh:
+		ApplyPreviewMesh(Animations);
+		return true;
+	case ESimpleAnimBulkOperation::SetAnimRootLock:
+		SetAnimRootLock(Settings.bEnable, Animations);
+		return true;
+	case ESimpleAnimBulkOperation::SetAnimEnableRootMotion:
+		SetAnimEnableRootMotion(Settings.bEnable, Animations);
+		return true;
+	case ESimpleAnimBulkOperation::ApplyAnimFloatCurves:
+		ApplyAnimFloatCurves(Animations, Settings.CurveSpecs);
+		return Settings.CurveSpecs.Num() > 0;
+	case ESimpleAnimBulkOperation::ReduceAnimCurveKeys:
+		ReduceAnimCurveKeys(Animations, Settings.CurveTolerance);
+		return true;
+	case ESimpleAnimBulkOperation::SetCompressionType:
+		if (UAnimCurveCompressionSettings* CurveCompressionSettings = Settings.CurveCompressionSettings.LoadSynchronous())
+		{
+			SetCompressionTypeForAnimations(Animations, CurveCompressionSettings);
+			return true;
+		}
+		return false;
+	case ESimpleAnimBulkOperation::CompressAnimations:
+		return CompressAnimationsAsync(Animations, Settings.TargetPlatformNames).Num() == 0;
+	case ESimpleAnimBulkOperation::RemoveAllAnimCurves:
+		RemoveAllAnimCurves(Animations);
+		return true;
+	case ESimpleAnimBulkOperation::RemoveAllAnimNotifies:
+		RemoveAllAnimNotifies(Animations);
+		return true;
+	case ESimpleAnimBulkOperation::RemoveAllAnimModifiers:
+		RemoveAllAnimModifiers(Animations);
+		return true;
+	case ESimpleAnimBulkOperation::AddAnimModifiers:
+		{
+			TArray<TSubclassOf<UAnimationModifier>> Modifiers;
+			for (const TSoftClassPtr<UAnimationModifier>& Modifier : Settings.Modifiers)
+			{
+				if (UClass* ModifierClass = Modifier.LoadSynchronous())
+				{
+					Modifiers.Add(ModifierClass);
+				}
 			}
+			if (Modifiers.Num() == 0 || Modifiers.Num() != Settings.Modifiers.Num())
+			{
+				return false;
+			}
+			AddAnimModifiersBatched(Animations, Modifiers);
+			return true;
 		}
+	case ESimpleAnimBulkOperation::SetImportRotation:
+		SetImportRotation(Animations, Settings.ImportRotation, Settings.bReimport);
+		return true;
+	default:
+		return false;
 	}
 }
 
+int32 USimpleAnimAssetEditorLib::RunBulkOperationStreaming(const TArray<FAssetData>& Assets,
+	const FSimpleAnimBulkSettings& Settings, int32 WindowSize, bool bSave)
+{
+	FSimpleAnimStreamingSettings StreamingSettings;
+	StreamingSettings.WindowSize = WindowSize;
+	StreamingSettings.bSave = bSave;
+	return FSimpleAnimStreamingIterator::RunBulkOperation(Assets, Settings, StreamingSettings).Modified.Num();
+}
+
+void USimpleAnimAssetEditorLib::ClearFingerprintCache()
+{
+	FSimpleAnimFingerprintCache::Clear();
+}
+
 void USimpleAnimAssetEditorLib::PrintAllAssetsToMessageLog(const TArray<UObject*>& Assets, FName LogName,
 	bool bOpenMessageLog)
 {
@@ -371,12 +1229,18 @@ void USimpleAnimAssetEditorLib::PrintAllAssetsToMessageLog(const TArray<UObject*
 
 TArray<FName> USimpleAnimAssetEditorLib::GetAssetDependencies_Name(const UObject* Asset)
 {
-	const FString PackageName = UPackageTools::FilenameToPackageName(Asset->GetPackage()->GetName());
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(GetAssetDependencies_Name);
+
+	TArray<FName> Dependencies;
+	if (!IsValid(Asset))
+	{
+		return Dependencies;
+	}
 
+	// The package name is already a long package name, there is no filename to convert
 	const IAssetRegistry* AssetRegistry = IAssetRegistry::Get();
 	constexpr FAssetRegistryDependencyOptions Options { true, true, false, false, false };
-	TArray<FName> Dependencies;
-	AssetRegistry->K2_GetDependencies(FName(PackageName), Options, Dependencies);
+	AssetRegistry->K2_GetDependencies(Asset->GetPackage()->GetFName(), Options, Dependencies);
 	return Dependencies;
 }
 
@@ -390,8 +1254,139 @@ TArray<FString> USimpleAnimAssetEditorLib::GetAssetDependencies(const UObject* A
 	return StringNames;
 }
 
+FSimpleAnimDependencyGraph USimpleAnimAssetEditorLib::GetAssetDependencyGraph(const TArray<UObject*>& Assets,
+	const FSimpleAnimDependencyFilter& Filter)
+{
+	TArray<FName> PackageNames;
+	for (const UObject* Asset : Assets)
+	{
+		if (IsValid(Asset))
+		{
+			PackageNames.AddUnique(Asset->GetPackage()->GetFName());
+		}
+	}
+	return FSimpleAnimDependencyWalker::Walk(PackageNames, Filter);
+}
+
+FSimpleAnimDependencyGraph USimpleAnimAssetEditorLib::GetPackageDependencyGraph(const TArray<FName>& PackageNames,
+	const FSimpleAnimDependencyFilter& Filter)
+{
+	return FSimpleAnimDependencyWalker::Walk(PackageNames, Filter);
+}
+
+bool USimpleAnimAssetEditorLib::ApplyPreviewMesh_Internal(UAnimSequence* Animation, USkeletalMesh* PreviewMesh, bool bMarkDirty)
+{
+	// GetPreviewMesh() would load the current mesh just to compare it
+	if (FSimpleAnimAssetRegistryTags::GetPreviewMeshPath(Animation) == FSoftObjectPath(PreviewMesh))
+	{
+		return false;
+	}
+
+	Animation->SetPreviewMesh(PreviewMesh, true);
+
+	if (bMarkDirty)
+	{
+		// ReSharper disable once CppExpressionWithoutSideEffects
+		Animation->MarkPackageDirty();
+		SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
+	}
+	return true;
+}
+
+TArray<FAssetData> USimpleAnimAssetEditorLib::FilterAssetsWithTagMismatch(const TArray<FAssetData>& Assets,
+	FName TagName, const FString& DesiredValue)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(FilterAssetsWithTagMismatch);
+
+	TArray<FAssetData> Mismatched;
+	for (const FAssetData& Asset : Assets)
+	{
+		if (!Asset.IsValid() || !Asset.IsInstanceOf(UAnimSequence::StaticClass()))
+		{
+			continue;
+		}
+
+		// Loaded animations may have unsaved changes, so only trust the registry for the ones on disk
+		if (!Asset.IsAssetLoaded())
+		{
+			FString TagValue;
+			if (Asset.GetTagValue(TagName, TagValue) && TagValue == DesiredValue)
+			{
+				continue;
+			}
+		}
+
+		Mismatched.Add(Asset);
+	}
+	return Mismatched;
+}
+
+TArray<UAnimSequence*> USimpleAnimAssetEditorLib::LoadAnimationsWithTagMismatch(const TArray<FAssetData>& Assets,
+	FName TagName, const FString& DesiredValue)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(LoadAnimationsWithTagMismatch);
+
+	TArray<UAnimSequence*> Animations;
+	for (const FAssetData& Asset : FilterAssetsWithTagMismatch(Assets, TagName, DesiredValue))
+	{
+		if (UAnimSequence* Animation = Cast<UAnimSequence>(Asset.GetAsset()))
+		{
+			Animations.Add(Animation);
+		}
+	}
+	return Animations;
+}
+
+bool USimpleAnimAssetEditorLib::GetFloatCurveId(const UAnimSequence* Animation, FName CurveName, bool bCreate,
+	FAnimationCurveIdentifier& OutCurveId)
+{
+	if (CurveName.IsNone())
+	{
+		return false;
+	}
+
+#if ENGINE_MINOR_VERSION >= 3
+	OutCurveId = FAnimationCurveIdentifier(CurveName, ERawCurveTrackTypes::RCT_Float);
+	return true;
+#else
+	USkeleton* Skeleton = Animation->GetSkeleton();
+	if (!IsValid(Skeleton))
+	{
+		return false;
+	}
+
+	FSmartName SmartName;
+	if (!Skeleton->GetSmartNameByName(USkeleton::AnimCurveMappingName, CurveName, SmartName))
+	{
+		if (!bCreate)
+		{
+			return false;
+		}
+		Skeleton->AddSmartNameAndModify(USkeleton::AnimCurveMappingName, CurveName, SmartName);
+	}
+
+	OutCurveId = FAnimationCurveIdentifier(SmartName, ERawCurveTrackTypes::RCT_Float);
+	return true;
+#endif
+}
+
+uint64 USimpleAnimAssetEditorLib::HashAnimModifiers(const TArray<TSubclassOf<UAnimationModifier>>& Modifiers)
+{
+	uint64 Hash = 0;
+	for (const TSubclassOf<UAnimationModifier>& Modifier : Modifiers)
+	{
+		if (Modifier)
+		{
+			Hash = FSimpleAnimFingerprintCache::HashObject(Modifier->GetDefaultObject(), Hash);
+		}
+	}
+	return Hash;
+}
+
 int32 USimpleAnimAssetEditorLib::RemoveAllAnimModifiers_Internal(UAnimSequence* Animation)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(RemoveAllAnimModifiers_Internal);
+
 	if (!IsValid(Animation))
 	{
 		return 0;
@@ -416,6 +1411,56 @@ int32 USimpleAnimAssetEditorLib::RemoveAllAnimModifiers_Internal(UAnimSequence*
 	return Removed;
 }
 
+UAnimationModifiersAssetUserData* USimpleAnimAssetEditorLib::GetOrCreateModifiersUserData(UAnimSequence* Animation)
+{
+	UAnimationModifiersAssetUserData* UserData = Animation->GetAssetUserData<UAnimationModifiersAssetUserData>();
+	if (!UserData)
+	{
+		UserData = NewObject<UAnimationModifiersAssetUserData>(Animation, UAnimationModifiersAssetUserData::StaticClass());
+		checkf(UserData, TEXT("Unable to instantiate AssetUserData class"));
+		UserData->SetFlags(RF_Transactional);
+		Animation->AddAssetUserData(UserData);
+
+		// ReSharper disable once CppExpressionWithoutSideEffects
+		Animation->MarkPackageDirty();
+		SIMPLEANIM_INC_STAT(STAT_SimpleAnim_PackagesDirtied);
+	}
+	return UserData;
+}
+
+bool USimpleAnimAssetEditorLib::ApplyAnimModifier_Internal(UAnimationModifiersAssetUserData* UserData,
+	UAnimSequence* Animation, const TSubclassOf<UAnimationModifier>& Modifier)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(ApplyAnimModifier_Internal);
+
+	const SimpleAnimAssetEditorLib::FScopedErrorCapture ErrorCapture;
+
+	UAnimationModifier* const* ExistingModifier = UserData->GetAnimationModifierInstances().FindByPredicate(
+		[Modifier](const UAnimationModifier* TestModifier)
+		{
+			return Modifier == TestModifier->GetClass();
+		});
+	const bool bAlreadyContainsModifier = ExistingModifier != nullptr;
+
+	if (!bAlreadyContainsModifier)
+	{
+		UAnimationModifier* Processor = CreateModifierInstance(UserData, Modifier, Modifier.GetDefaultObject());
+		const TArray<UAnimationModifier*>& Instances = UserData->GetAnimationModifierInstances();
+		TArray<UAnimationModifier*>& MutableInstances = const_cast<TArray<UAnimationModifier*>&>(Instances);
+		MutableInstances.Add(Processor);
+		Processor->ApplyToAnimationSequence(Animation);
+	}
+	else
+	{
+		// Reapply the existing modifier instead of adding a new one
+		// We cannot get a non-const because Epic protected and used friend classes
+		const UAnimationModifier* MutableModifier = const_cast<UAnimationModifier*>(*ExistingModifier);
+		MutableModifier->ApplyToAnimationSequence(Animation);
+	}
+
+	return !ErrorCapture.bErrorLogged;
+}
+
 UAnimationModifier* USimpleAnimAssetEditorLib::CreateModifierInstance(UObject* Outer, const UClass* InClass,
 	UObject* Template)
 {
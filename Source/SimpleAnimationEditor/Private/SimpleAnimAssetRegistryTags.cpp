@@ -0,0 +1,88 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimAssetRegistryTags.h"
+
+#include "Animation/AnimCurveCompressionSettings.h"
+#include "Animation/AnimSequence.h"
+
+#if ENGINE_MINOR_VERSION >= 4
+#include "UObject/AssetRegistryTagsContext.h"
+#endif
+
+const FName FSimpleAnimAssetRegistryTags::ForceRootLock = TEXT("SimpleAnim_ForceRootLock");
+const FName FSimpleAnimAssetRegistryTags::EnableRootMotion = TEXT("SimpleAnim_EnableRootMotion");
+const FName FSimpleAnimAssetRegistryTags::CurveCompressionSettings = TEXT("SimpleAnim_CurveCompressionSettings");
+const FName FSimpleAnimAssetRegistryTags::PreviewMesh = TEXT("SimpleAnim_PreviewMesh");
+
+FDelegateHandle FSimpleAnimAssetRegistryTags::OnGetExtraObjectTagsHandle;
+
+namespace SimpleAnimAssetRegistryTags
+{
+	template<typename AddTagFunc>
+	static void GetAnimSequenceTags(const UObject* Object, AddTagFunc AddTag)
+	{
+		const UAnimSequence* Animation = Cast<UAnimSequence>(Object);
+		if (!Animation || Animation->HasAnyFlags(RF_ClassDefaultObject))
+		{
+			return;
+		}
+
+		using FTags = FSimpleAnimAssetRegistryTags;
+		AddTag(FTags::ForceRootLock, FTags::BoolToTag(Animation->bForceRootLock));
+		AddTag(FTags::EnableRootMotion, FTags::BoolToTag(Animation->bEnableRootMotion));
+		AddTag(FTags::CurveCompressionSettings, FTags::ObjectToTag(FSoftObjectPath(Animation->CurveCompressionSettings.Get())));
+		AddTag(FTags::PreviewMesh, FTags::ObjectToTag(FTags::GetPreviewMeshPath(Animation)));
+	}
+
+#if ENGINE_MINOR_VERSION >= 4
+	static void OnGetExtraObjectTags(FAssetRegistryTagsContext Context)
+	{
+		GetAnimSequenceTags(Context.GetObject(), [&Context](FName Name, const FString& Value)
+		{
+			Context.AddTag(UObject::FAssetRegistryTag(Name, Value, UObject::FAssetRegistryTag::TT_Hidden));
+		});
+	}
+#else
+	static void OnGetExtraObjectTags(const UObject* Object, TArray<UObject::FAssetRegistryTag>& OutTags)
+	{
+		GetAnimSequenceTags(Object, [&OutTags](FName Name, const FString& Value)
+		{
+			OutTags.Add(UObject::FAssetRegistryTag(Name, Value, UObject::FAssetRegistryTag::TT_Hidden));
+		});
+	}
+#endif
+}
+
+void FSimpleAnimAssetRegistryTags::Register()
+{
+#if ENGINE_MINOR_VERSION >= 4
+	OnGetExtraObjectTagsHandle = UObject::FAssetRegistryTag::OnGetExtraObjectTagsWithContext.AddStatic(
+		&SimpleAnimAssetRegistryTags::OnGetExtraObjectTags);
+#else
+	OnGetExtraObjectTagsHandle = UObject::FAssetRegistryTag::OnGetExtraObjectTags.AddStatic(
+		&SimpleAnimAssetRegistryTags::OnGetExtraObjectTags);
+#endif
+}
+
+void FSimpleAnimAssetRegistryTags::Unregister()
+{
+#if ENGINE_MINOR_VERSION >= 4
+	UObject::FAssetRegistryTag::OnGetExtraObjectTagsWithContext.Remove(OnGetExtraObjectTagsHandle);
+#else
+	UObject::FAssetRegistryTag::OnGetExtraObjectTags.Remove(OnGetExtraObjectTagsHandle);
+#endif
+	OnGetExtraObjectTagsHandle.Reset();
+}
+
+FSoftObjectPath FSimpleAnimAssetRegistryTags::GetPreviewMeshPath(const UAnimationAsset* Animation)
+{
+	// GetPreviewMesh() would load the mesh, read the soft pointer instead
+	static const FSoftObjectProperty* PreviewMeshProperty = FindFProperty<FSoftObjectProperty>(
+		UAnimationAsset::StaticClass(), TEXT("PreviewSkeletalMesh"));
+	if (!Animation || !PreviewMeshProperty)
+	{
+		return FSoftObjectPath();
+	}
+	return PreviewMeshProperty->GetPropertyValue_InContainer(Animation).ToSoftObjectPath();
+}
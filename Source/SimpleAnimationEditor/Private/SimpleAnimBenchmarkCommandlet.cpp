@@ -0,0 +1,493 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimBenchmarkCommandlet.h"
+
+#include "AnimationBlueprintLibrary.h"
+#include "AnimationModifier.h"
+#include "ReferenceSkeleton.h"
+#include "SimpleAnimAssetEditorLib.h"
+#include "SimpleAnimEditorLib.h"
+#include "Animation/AnimData/IAnimationDataController.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/Skeleton.h"
+#include "Dom/JsonObject.h"
+#include "Engine/SkeletalMesh.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/StrongObjectPtr.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SimpleAnimBenchmarkCommandlet)
+
+#define LOCTEXT_NAMESPACE "SimpleAnimBenchmarkCommandlet"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSimpleAnimBenchmark, Log, All);
+
+namespace SimpleAnimBenchmark
+{
+	/** Modifiers live in an uncooked module the editor module can't depend on, so find it by name */
+	static const TCHAR* CopyIKBonesModifierPath = TEXT("/Script/SimpleAnimationModifiers.CopyIKBonesModifier");
+
+	static constexpr int32 FrameRate = 30;
+	static constexpr int32 NumCurves = 4;
+
+	static TArray<int32> ParseIntList(const FString& Params, const TCHAR* Key, const TArray<int32>& Default)
+	{
+		FString Value;
+		if (!FParse::Value(*Params, Key, Value))
+		{
+			return Default;
+		}
+
+		TArray<FString> Entries;
+		Value.ParseIntoArray(Entries, TEXT(","));
+
+		TArray<int32> Result;
+		for (const FString& Entry : Entries)
+		{
+			const int32 Number = FCString::Atoi(*Entry);
+			if (Number > 0)
+			{
+				Result.Add(Number);
+			}
+		}
+		return Result.Num() > 0 ? Result : Default;
+	}
+}
+
+USimpleAnimBenchmarkCommandlet::USimpleAnimBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 USimpleAnimBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace SimpleAnimBenchmark;
+
+	const TArray<int32> BoneCounts = ParseIntList(Params, TEXT("Bones="), { 64, 256 });
+	const TArray<int32> FrameCounts = ParseIntList(Params, TEXT("Frames="), { 60, 600 });
+	const TArray<int32> CurveKeyCounts = ParseIntList(Params, TEXT("CurveKeys="), { 100, 1000 });
+
+	int32 NumSequences = 20;
+	FParse::Value(*Params, TEXT("Sequences="), NumSequences);
+	NumSequences = FMath::Max(1, NumSequences);
+
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	Iterations = FMath::Max(1, Iterations);
+
+	FString OutputDir = FPaths::ProjectSavedDir() / TEXT("SimpleAnimation") / TEXT("Benchmark");
+	FParse::Value(*Params, TEXT("Output="), OutputDir);
+
+	const TSubclassOf<UAnimationModifier> CopyIKClass = StaticLoadClass(UAnimationModifier::StaticClass(), nullptr,
+		CopyIKBonesModifierPath);
+	if (!CopyIKClass)
+	{
+		UE_LOG(LogSimpleAnimBenchmark, Warning, TEXT("%s not found, skipping modifier benchmarks"), CopyIKBonesModifierPath);
+	}
+	FBoolProperty* ParallelProperty = CopyIKClass ? FindFProperty<FBoolProperty>(CopyIKClass, TEXT("bParallelEvaluate")) : nullptr;
+
+	Results.Reset();
+
+	// Pose sampling, loop detection and modifiers scale with bones and frames
+	for (const int32 BoneCount : BoneCounts)
+	{
+		const TStrongObjectPtr<USkeleton> Skeleton(CreateSkeleton(BoneCount));
+		const int32 NumBones = Skeleton->GetReferenceSkeleton().GetRawBoneNum();
+		for (const int32 NumFrames : FrameCounts)
+		{
+			UE_LOG(LogSimpleAnimBenchmark, Display, TEXT("Benchmarking %d bones, %d frames"), NumBones, NumFrames);
+
+			const TStrongObjectPtr<UAnimSequence> Sequence(CreateSequence(Skeleton.Get(), NumFrames, NumCurves));
+			UAnimSequence* Animation = Sequence.Get();
+
+			Time(TEXT("GetPoseForTime"), NumBones, NumFrames, 0, [Animation, NumFrames]
+			{
+				TArray<FTransform> Pose;
+				for (int32 Frame = 0; Frame <= NumFrames; ++Frame)
+				{
+					USimpleAnimEditorLib::GetPoseForTime(Animation, Pose, static_cast<float>(Frame) / FrameRate);
+				}
+			});
+
+			Time(TEXT("IsLoopingAnimation"), NumBones, NumFrames, 0, [Animation]
+			{
+				USimpleAnimEditorLib::IsLoopingAnimation(Animation);
+			});
+
+			Time(TEXT("FindBestLoopPoints"), NumBones, NumFrames, 0, [Animation]
+			{
+				FSimpleAnimLoopPoints LoopPoints;
+				USimpleAnimEditorLib::FindBestLoopPoints(Animation, FSimpleAnimLoopSearchSettings(), LoopPoints);
+			});
+
+			if (CopyIKClass)
+			{
+				const TStrongObjectPtr<UAnimationModifier> Modifier(NewObject<UAnimationModifier>(GetTransientPackage(), CopyIKClass));
+				for (const bool bParallel : { false, true })
+				{
+					if (bParallel && !ParallelProperty)
+					{
+						continue;
+					}
+					if (ParallelProperty)
+					{
+						ParallelProperty->SetPropertyValue_InContainer(Modifier.Get(), bParallel);
+					}
+
+					Time(bParallel ? TEXT("CopyIKBonesModifier_Parallel") : TEXT("CopyIKBonesModifier"), NumBones, NumFrames, 0,
+						[&Modifier, Animation]
+					{
+						Modifier->ApplyToAnimationSequence(Animation);
+					});
+				}
+			}
+		}
+	}
+
+	// Curve keying only scales with the number of keys
+	for (const int32 NumCurveKeys : CurveKeyCounts)
+	{
+		TMap<float, float> TimeValueMap;
+		TimeValueMap.Reserve(NumCurveKeys);
+		for (int32 KeyIndex = 0; KeyIndex < NumCurveKeys; ++KeyIndex)
+		{
+			const float KeyTime = static_cast<float>(KeyIndex) / FrameRate;
+			TimeValueMap.Add(KeyTime, FMath::Sin(KeyTime * 3.f) + 0.25f * FMath::Sin(KeyTime * 17.f));
+		}
+
+		Time(TEXT("SetAutoCubicKeyInterpolation"), 0, 0, NumCurveKeys, [&TimeValueMap]
+		{
+			TArray<FRichCurveKey> Keys;
+			USimpleAnimEditorLib::SetAutoCubicKeyInterpolation(TimeValueMap, Keys);
+		});
+
+		Time(TEXT("SetAutoLinearKeyInterpolation"), 0, 0, NumCurveKeys, [&TimeValueMap]
+		{
+			TArray<FRichCurveKey> Keys;
+			USimpleAnimEditorLib::SetAutoLinearKeyInterpolation(TimeValueMap, Keys);
+		});
+
+		TArray<float> Times;
+		TArray<float> Values;
+		TimeValueMap.GenerateKeyArray(Times);
+		TimeValueMap.GenerateValueArray(Values);
+		Time(TEXT("BuildAutoCubicKeys"), 0, 0, NumCurveKeys, [&Times, &Values]
+		{
+			TArray<FRichCurveKey> Keys;
+			USimpleAnimEditorLib::BuildAutoCubicKeys(Times, Values, Keys);
+		});
+	}
+
+	// Bulk asset operations over a batch of the smallest sequences
+	{
+		const int32 NumFrames = FrameCounts[0];
+		UE_LOG(LogSimpleAnimBenchmark, Display, TEXT("Benchmarking bulk operations over %d sequences"), NumSequences);
+
+		const TStrongObjectPtr<USkeleton> Skeleton(CreateSkeleton(BoneCounts[0]));
+		const int32 NumBones = Skeleton->GetReferenceSkeleton().GetRawBoneNum();
+		TArray<TStrongObjectPtr<UAnimSequence>> StrongSequences;
+		TArray<UAnimSequence*> Animations;
+		for (int32 SequenceIndex = 0; SequenceIndex < NumSequences; ++SequenceIndex)
+		{
+			UAnimSequence* Animation = CreateSequence(Skeleton.Get(), NumFrames, NumCurves);
+			StrongSequences.Emplace(Animation);
+			Animations.Add(Animation);
+		}
+
+		// Toggle each iteration so every animation actually changes
+		bool bToggle = false;
+		Time(TEXT("SetAnimRootLock"), NumBones, NumFrames, 0, [&Animations, &bToggle]
+		{
+			bToggle = !bToggle;
+			USimpleAnimAssetEditorLib::SetAnimRootLock(bToggle, Animations);
+		});
+
+		Time(TEXT("SetAnimEnableRootMotion"), NumBones, NumFrames, 0, [&Animations, &bToggle]
+		{
+			bToggle = !bToggle;
+			USimpleAnimAssetEditorLib::SetAnimEnableRootMotion(bToggle, Animations);
+		});
+
+		Time(TEXT("AddAnimFloatCurve"), NumBones, NumFrames, 0, [&Animations]
+		{
+			USimpleAnimAssetEditorLib::AddAnimFloatCurve(Animations, TEXT("BenchmarkCurve"));
+		});
+
+		// Each iteration has to add the curve back before removing it, so both are timed together
+		Time(TEXT("AddRemoveAnimFloatCurve"), NumBones, NumFrames, 0, [&Animations]
+		{
+			USimpleAnimAssetEditorLib::AddAnimFloatCurve(Animations, TEXT("BenchmarkCurve"));
+			USimpleAnimAssetEditorLib::RemoveAnimFloatCurve(Animations, TEXT("BenchmarkCurve"));
+		});
+
+		if (CopyIKClass)
+		{
+			Time(TEXT("AddAnimModifiersBatched"), NumBones, NumFrames, 0, [&Animations, &CopyIKClass]
+			{
+				USimpleAnimAssetEditorLib::AddAnimModifiersBatched(Animations, { CopyIKClass });
+			});
+		}
+	}
+
+	if (!WriteResults(OutputDir))
+	{
+		return 1;
+	}
+
+	FString BaselineFile;
+	if (FParse::Value(*Params, TEXT("Baseline="), BaselineFile))
+	{
+		double MaxRegression = 0.2;
+		FParse::Value(*Params, TEXT("MaxRegression="), MaxRegression);
+		if (!CompareToBaseline(BaselineFile, MaxRegression))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void USimpleAnimBenchmarkCommandlet::Time(const FString& Name, int32 NumBones, int32 NumFrames, int32 NumCurveKeys,
+	const TFunctionRef<void()>& Func)
+{
+	FBenchmarkResult& Result = Results.AddDefaulted_GetRef();
+	Result.Name = Name;
+	Result.NumBones = NumBones;
+	Result.NumFrames = NumFrames;
+	Result.NumCurveKeys = NumCurveKeys;
+	Result.Iterations = Iterations;
+	Result.MinMs = DBL_MAX;
+
+	double TotalMs = 0.0;
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		Func();
+		const double ElapsedMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		TotalMs += ElapsedMs;
+		Result.MinMs = FMath::Min(Result.MinMs, ElapsedMs);
+		Result.MaxMs = FMath::Max(Result.MaxMs, ElapsedMs);
+	}
+	Result.MeanMs = TotalMs / Iterations;
+
+	UE_LOG(LogSimpleAnimBenchmark, Display, TEXT("%s: min %.3fms, mean %.3fms, max %.3fms"), *Result.GetKey(),
+		Result.MinMs, Result.MeanMs, Result.MaxMs);
+}
+
+USkeleton* USimpleAnimBenchmarkCommandlet::CreateSkeleton(int32 NumBones)
+{
+	USkeletalMesh* Mesh = NewObject<USkeletalMesh>(GetTransientPackage(), NAME_None, RF_Transient);
+	USkeleton* Skeleton = NewObject<USkeleton>(GetTransientPackage(), NAME_None, RF_Transient);
+
+	{
+		FReferenceSkeletonModifier Modifier(Mesh->GetRefSkeleton(), Skeleton);
+		auto AddBone = [&Modifier](const FName& BoneName, int32 ParentIndex, const FVector& Offset)
+		{
+			Modifier.Add(FMeshBoneInfo(BoneName, BoneName.ToString(), ParentIndex), FTransform(Offset));
+			return Modifier.GetReferenceSkeleton().GetRawBoneNum() - 1;
+		};
+
+		// Bones UCopyIKBonesModifier copies by default
+		const int32 Root = AddBone(TEXT("root"), INDEX_NONE, FVector::ZeroVector);
+		const int32 Pelvis = AddBone(TEXT("pelvis"), Root, FVector(0.f, 0.f, 95.f));
+		const int32 Spine = AddBone(TEXT("spine_01"), Pelvis, FVector(0.f, 0.f, 20.f));
+		AddBone(TEXT("hand_r"), Spine, FVector(50.f, -20.f, 30.f));
+		AddBone(TEXT("hand_l"), Spine, FVector(50.f, 20.f, 30.f));
+		AddBone(TEXT("foot_r"), Pelvis, FVector(0.f, -15.f, -85.f));
+		AddBone(TEXT("foot_l"), Pelvis, FVector(0.f, 15.f, -85.f));
+		const int32 IKHandGun = AddBone(TEXT("ik_hand_gun"), Root, FVector(50.f, -20.f, 145.f));
+		AddBone(TEXT("ik_hand_r"), IKHandGun, FVector::ZeroVector);
+		AddBone(TEXT("ik_hand_l"), IKHandGun, FVector(0.f, 40.f, 0.f));
+		AddBone(TEXT("ik_foot_r"), Root, FVector(0.f, -15.f, 10.f));
+		AddBone(TEXT("ik_foot_l"), Root, FVector(0.f, 15.f, 10.f));
+
+		// Fill the rest with chains of 8 off the spine, so depth stays realistic
+		constexpr int32 ChainLength = 8;
+		int32 ChainParent = Spine;
+		for (int32 BoneIndex = Modifier.GetReferenceSkeleton().GetRawBoneNum(); BoneIndex < NumBones; ++BoneIndex)
+		{
+			const int32 ChainIndex = BoneIndex % ChainLength;
+			const int32 Parent = ChainIndex == 0 ? Spine : ChainParent;
+			ChainParent = AddBone(*FString::Printf(TEXT("bone_%03d"), BoneIndex), Parent, FVector(5.f, 0.f, 0.f));
+		}
+
+		if (NumBones < Modifier.GetReferenceSkeleton().GetRawBoneNum())
+		{
+			UE_LOG(LogSimpleAnimBenchmark, Warning, TEXT("%d bones requested, using the minimum of %d"), NumBones,
+				Modifier.GetReferenceSkeleton().GetRawBoneNum());
+		}
+	}
+
+	Skeleton->MergeAllBonesToBoneTree(Mesh);
+	Mesh->SetSkeleton(Skeleton);
+	return Skeleton;
+}
+
+UAnimSequence* USimpleAnimBenchmarkCommandlet::CreateSequence(USkeleton* Skeleton, int32 NumFrames, int32 NumCurves)
+{
+	using namespace SimpleAnimBenchmark;
+
+	UAnimSequence* Animation = NewObject<UAnimSequence>(GetTransientPackage(), NAME_None, RF_Transient);
+	Animation->SetSkeleton(Skeleton);
+
+	const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
+	const int32 NumKeys = NumFrames + 1;
+
+	IAnimationDataController& Controller = Animation->GetController();
+#if ENGINE_MINOR_VERSION >= 2
+	Controller.InitializeModel();
+#endif
+
+	{
+		constexpr bool bShouldTransact = false;
+		IAnimationDataController::FScopedBracket Bracket(Controller, LOCTEXT("CreateSequence", "Generating benchmark sequence"),
+			bShouldTransact);
+
+		Controller.SetFrameRate(FFrameRate(FrameRate, 1), bShouldTransact);
+#if ENGINE_MINOR_VERSION >= 2
+		Controller.SetNumberOfFrames(FFrameNumber(NumFrames), bShouldTransact);
+#else
+		Controller.SetPlayLength(static_cast<float>(NumFrames) / FrameRate, bShouldTransact);
+#endif
+
+		// Every bone moves, so nothing can be skipped when evaluating
+		TArray<FVector> PositionalKeys;
+		TArray<FQuat> RotationalKeys;
+		TArray<FVector> ScalingKeys;
+		PositionalKeys.SetNumUninitialized(NumKeys);
+		RotationalKeys.SetNumUninitialized(NumKeys);
+		ScalingKeys.Init(FVector::OneVector, NumKeys);
+		for (int32 BoneIndex = 0; BoneIndex < RefSkeleton.GetRawBoneNum(); ++BoneIndex)
+		{
+			const FName BoneName = RefSkeleton.GetBoneName(BoneIndex);
+			const FVector RefLocation = RefSkeleton.GetRefBonePose()[BoneIndex].GetLocation();
+			for (int32 Key = 0; Key < NumKeys; ++Key)
+			{
+				const float Phase = static_cast<float>(Key) / FrameRate * 2.f + BoneIndex;
+				PositionalKeys[Key] = RefLocation + FVector(FMath::Sin(Phase), FMath::Cos(Phase), 0.f) * 2.f;
+				RotationalKeys[Key] = FRotator(FMath::Sin(Phase) * 20.f, FMath::Cos(Phase) * 20.f, 0.f).Quaternion();
+			}
+
+#if ENGINE_MINOR_VERSION >= 2
+			Controller.AddBoneCurve(BoneName, bShouldTransact);
+#else
+			Controller.AddBoneTrack(BoneName, bShouldTransact);
+#endif
+			Controller.SetBoneTrackKeys(BoneName, PositionalKeys, RotationalKeys, ScalingKeys, bShouldTransact);
+		}
+	}
+
+	// One key per frame for each curve
+	TArray<float> Times;
+	TArray<float> Values;
+	Times.SetNumUninitialized(NumKeys);
+	Values.SetNumUninitialized(NumKeys);
+	for (int32 CurveIndex = 0; CurveIndex < NumCurves; ++CurveIndex)
+	{
+		for (int32 Key = 0; Key < NumKeys; ++Key)
+		{
+			Times[Key] = static_cast<float>(Key) / FrameRate;
+			Values[Key] = FMath::Sin(Times[Key] + CurveIndex);
+		}
+
+		const FName CurveName = *FString::Printf(TEXT("BenchmarkCurve_%d"), CurveIndex);
+		UAnimationBlueprintLibrary::AddCurve(Animation, CurveName, ERawCurveTrackTypes::RCT_Float, false);
+		UAnimationBlueprintLibrary::AddFloatCurveKeys(Animation, CurveName, Times, Values);
+	}
+
+	return Animation;
+}
+
+bool USimpleAnimBenchmarkCommandlet::WriteResults(const FString& OutputDir) const
+{
+	FString Csv = TEXT("Name,Bones,Frames,CurveKeys,Iterations,MinMs,MeanMs,MaxMs\n");
+	TArray<TSharedPtr<FJsonValue>> JsonResults;
+	for (const FBenchmarkResult& Result : Results)
+	{
+		Csv += FString::Printf(TEXT("%s,%d,%d,%d,%d,%.4f,%.4f,%.4f\n"), *Result.Name, Result.NumBones, Result.NumFrames,
+			Result.NumCurveKeys, Result.Iterations, Result.MinMs, Result.MeanMs, Result.MaxMs);
+
+		const TSharedRef<FJsonObject> JsonResult = MakeShared<FJsonObject>();
+		JsonResult->SetStringField(TEXT("Name"), Result.Name);
+		JsonResult->SetNumberField(TEXT("Bones"), Result.NumBones);
+		JsonResult->SetNumberField(TEXT("Frames"), Result.NumFrames);
+		JsonResult->SetNumberField(TEXT("CurveKeys"), Result.NumCurveKeys);
+		JsonResult->SetNumberField(TEXT("Iterations"), Result.Iterations);
+		JsonResult->SetNumberField(TEXT("MinMs"), Result.MinMs);
+		JsonResult->SetNumberField(TEXT("MeanMs"), Result.MeanMs);
+		JsonResult->SetNumberField(TEXT("MaxMs"), Result.MaxMs);
+		JsonResults.Add(MakeShared<FJsonValueObject>(JsonResult));
+	}
+
+	const TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetStringField(TEXT("Platform"), FPlatformProperties::IniPlatformName());
+	Json->SetStringField(TEXT("Cpu"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+	Json->SetArrayField(TEXT("Results"), JsonResults);
+
+	FString JsonString;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonString);
+	FJsonSerializer::Serialize(Json, Writer);
+
+	const FString CsvFile = OutputDir / TEXT("SimpleAnimBenchmark.csv");
+	const FString JsonFile = OutputDir / TEXT("SimpleAnimBenchmark.json");
+	if (!FFileHelper::SaveStringToFile(Csv, *CsvFile) || !FFileHelper::SaveStringToFile(JsonString, *JsonFile))
+	{
+		UE_LOG(LogSimpleAnimBenchmark, Error, TEXT("Failed to write results to %s"), *OutputDir);
+		return false;
+	}
+
+	UE_LOG(LogSimpleAnimBenchmark, Display, TEXT("Wrote %d results to %s and %s"), Results.Num(), *CsvFile, *JsonFile);
+	return true;
+}
+
+bool USimpleAnimBenchmarkCommandlet::CompareToBaseline(const FString& BaselineFile, double MaxRegression) const
+{
+	FString JsonString;
+	TSharedPtr<FJsonObject> Json;
+	if (!FFileHelper::LoadFileToString(JsonString, *BaselineFile) ||
+		!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(JsonString), Json) || !Json.IsValid())
+	{
+		UE_LOG(LogSimpleAnimBenchmark, Error, TEXT("Failed to read baseline %s"), *BaselineFile);
+		return false;
+	}
+
+	TMap<FString, double> BaselineMeans;
+	for (const TSharedPtr<FJsonValue>& Value : Json->GetArrayField(TEXT("Results")))
+	{
+		const TSharedPtr<FJsonObject> Object = Value->AsObject();
+		if (!Object.IsValid())
+		{
+			continue;
+		}
+
+		FBenchmarkResult Baseline;
+		Baseline.Name = Object->GetStringField(TEXT("Name"));
+		Baseline.NumBones = static_cast<int32>(Object->GetNumberField(TEXT("Bones")));
+		Baseline.NumFrames = static_cast<int32>(Object->GetNumberField(TEXT("Frames")));
+		Baseline.NumCurveKeys = static_cast<int32>(Object->GetNumberField(TEXT("CurveKeys")));
+		BaselineMeans.Add(Baseline.GetKey(), Object->GetNumberField(TEXT("MeanMs")));
+	}
+
+	bool bPassed = true;
+	for (const FBenchmarkResult& Result : Results)
+	{
+		const double* BaselineMean = BaselineMeans.Find(Result.GetKey());
+		if (BaselineMean && Result.MeanMs > *BaselineMean * (1.0 + MaxRegression))
+		{
+			UE_LOG(LogSimpleAnimBenchmark, Error, TEXT("%s regressed: mean %.3fms, baseline %.3fms"), *Result.GetKey(),
+				Result.MeanMs, *BaselineMean);
+			bPassed = false;
+		}
+	}
+	return bPassed;
+}
+
+#undef LOCTEXT_NAMESPACE
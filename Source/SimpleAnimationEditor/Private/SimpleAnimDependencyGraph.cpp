@@ -0,0 +1,186 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimDependencyGraph.h"
+
+#include "SimpleAnimStats.h"
+#include "Async/ParallelFor.h"
+#include "AssetRegistry/AssetData.h"
+#include "AssetRegistry/IAssetRegistry.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SimpleAnimDependencyGraph)
+
+namespace SimpleAnimDependencyGraph
+{
+	/** Registry data for one package, gathered on a worker thread */
+	struct FPackageInfo
+	{
+		FTopLevelAssetPath AssetClassPath;
+		int64 DiskSize = 0;
+		TArray<FName> Dependencies;
+	};
+
+	static bool IsScriptPackage(FName PackageName)
+	{
+		return FNameBuilder(PackageName).ToView().StartsWith(TEXT("/Script/"));
+	}
+}
+
+FSimpleAnimDependencyGraph FSimpleAnimDependencyWalker::Walk(TConstArrayView<FName> RootPackageNames,
+	const FSimpleAnimDependencyFilter& Filter)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(WalkDependencies);
+
+	using namespace SimpleAnimDependencyGraph;
+
+	const IAssetRegistry& AssetRegistry = *IAssetRegistry::Get();
+
+	UE::AssetRegistry::FDependencyQuery Query;
+	if (Filter.bHardReferences != Filter.bSoftReferences)
+	{
+		Query = UE::AssetRegistry::FDependencyQuery(Filter.bHardReferences ?
+			UE::AssetRegistry::EDependencyQuery::Hard : UE::AssetRegistry::EDependencyQuery::Soft);
+	}
+	const bool bFollowReferences = Filter.bHardReferences || Filter.bSoftReferences;
+
+	// Every package walked in the order it was reached, so each level of the walk is a contiguous range
+	TArray<FName> Visited;
+	TArray<int32> Depths;
+	TArray<FPackageInfo> Infos;
+	TMap<FName, int32> VisitedIndices;
+
+	auto Visit = [&](FName PackageName, int32 Depth)
+	{
+		if (PackageName.IsNone() || (!Filter.bIncludeScriptPackages && IsScriptPackage(PackageName)) ||
+			VisitedIndices.Contains(PackageName))
+		{
+			return;
+		}
+
+		VisitedIndices.Add(PackageName, Visited.Num());
+		Visited.Add(PackageName);
+		Depths.Add(Depth);
+	};
+
+	for (const FName RootPackageName : RootPackageNames)
+	{
+		Visit(RootPackageName, 0);
+	}
+
+	for (int32 LevelStart = 0; LevelStart < Visited.Num();)
+	{
+		const int32 LevelEnd = Visited.Num();
+		const int32 Depth = Depths[LevelStart];
+		const bool bExpand = bFollowReferences && (Filter.MaxDepth <= 0 || Depth < Filter.MaxDepth);
+		Infos.SetNum(LevelEnd);
+
+		// Registry reads are thread safe, and are nearly all of the cost
+		ParallelFor(LevelEnd - LevelStart, [&](int32 LevelIndex)
+		{
+			const int32 Index = LevelStart + LevelIndex;
+			FPackageInfo& Info = Infos[Index];
+
+			// On disk only, finding in memory assets isn't safe off the game thread
+			TArray<FAssetData> Assets;
+			AssetRegistry.GetAssetsByPackageName(Visited[Index], Assets, true);
+			const FAssetData* MainAsset = Assets.FindByPredicate([](const FAssetData& Asset) { return Asset.IsUAsset(); });
+			if (!MainAsset && Assets.Num() > 0)
+			{
+				MainAsset = &Assets[0];
+			}
+			if (MainAsset)
+			{
+				Info.AssetClassPath = MainAsset->AssetClassPath;
+			}
+
+			if (const TOptional<FAssetPackageData> PackageData = AssetRegistry.GetAssetPackageDataCopy(Visited[Index]))
+			{
+				Info.DiskSize = PackageData->DiskSize;
+			}
+
+			if (bExpand)
+			{
+				AssetRegistry.GetDependencies(Visited[Index], Info.Dependencies, UE::AssetRegistry::EDependencyCategory::Package, Query);
+			}
+		});
+
+		// Merge in order on this thread, so the graph doesn't depend on how the workers were scheduled
+		for (int32 Index = LevelStart; Index < LevelEnd; ++Index)
+		{
+			for (const FName Dependency : Infos[Index].Dependencies)
+			{
+				Visit(Dependency, Depth + 1);
+			}
+		}
+
+		LevelStart = LevelEnd;
+	}
+
+	// Classes, and their children, the result is limited to
+	TSet<FTopLevelAssetPath> FilterClassPaths;
+	{
+		TArray<FTopLevelAssetPath> ClassPaths;
+		for (const TSubclassOf<UObject>& Class : Filter.Classes)
+		{
+			if (Class)
+			{
+				ClassPaths.Add(Class->GetClassPathName());
+			}
+		}
+		if (ClassPaths.Num() > 0)
+		{
+			AssetRegistry.GetDerivedClassNames(ClassPaths, {}, FilterClassPaths);
+		}
+	}
+
+	FSimpleAnimDependencyGraph Graph;
+	Graph.NumVisited = Visited.Num();
+
+	TArray<int32> NodeIndices;
+	NodeIndices.Init(INDEX_NONE, Visited.Num());
+	for (int32 Index = 0; Index < Visited.Num(); ++Index)
+	{
+		const FPackageInfo& Info = Infos[Index];
+		const bool bRoot = Depths[Index] == 0;
+		if (!bRoot && Filter.Classes.Num() > 0 && !FilterClassPaths.Contains(Info.AssetClassPath))
+		{
+			continue;
+		}
+
+		NodeIndices[Index] = Graph.Nodes.Num();
+		FSimpleAnimDependencyNode& Node = Graph.Nodes.AddDefaulted_GetRef();
+		Node.PackageName = Visited[Index];
+		Node.AssetClass = Info.AssetClassPath.GetAssetName();
+		Node.Depth = Depths[Index];
+		Node.DiskSize = Info.DiskSize;
+
+		Graph.TotalDiskSize += Info.DiskSize;
+		Graph.NumNodesByClass.FindOrAdd(Node.AssetClass)++;
+	}
+
+	// Edges between packages that made it into the result
+	for (int32 Index = 0; Index < Visited.Num(); ++Index)
+	{
+		if (NodeIndices[Index] == INDEX_NONE)
+		{
+			continue;
+		}
+
+		for (const FName Dependency : Infos[Index].Dependencies)
+		{
+			const int32* DependencyIndex = VisitedIndices.Find(Dependency);
+			const int32 DependencyNode = DependencyIndex ? NodeIndices[*DependencyIndex] : INDEX_NONE;
+			if (DependencyNode != INDEX_NONE && DependencyNode != NodeIndices[Index])
+			{
+				TArray<int32>& Dependencies = Graph.Nodes[NodeIndices[Index]].Dependencies;
+				if (!Dependencies.Contains(DependencyNode))
+				{
+					Dependencies.Add(DependencyNode);
+					Graph.Nodes[DependencyNode].NumReferencers++;
+				}
+			}
+		}
+	}
+
+	return Graph;
+}
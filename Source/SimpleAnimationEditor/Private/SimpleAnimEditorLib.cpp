@@ -3,7 +3,9 @@
 
 #include "SimpleAnimEditorLib.h"
 
-#include "AnimPose.h"
+#include "SimpleAnimCurveKeyBuilder.h"
+#include "SimpleAnimStats.h"
+#include "Async/ParallelFor.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(SimpleAnimEditorLib)
 
@@ -99,84 +101,234 @@ void USimpleAnimEditorLib::SetAutoLinearKeyInterpolation(const TMap<float, float
 void USimpleAnimEditorLib::SetAutoKeyInterpolation(ERichCurveInterpMode InterpMode,
 	const TMap<float, float>& TimeValueMap, TArray<FRichCurveKey>& OutKeys)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(SetAutoKeyInterpolation);
+
 	OutKeys.Reset();
 	
 	if (TimeValueMap.Num() <= 1)
 	{
 		return;
 	}
-	
-	for (auto& Itr : TimeValueMap)
+
+	// Keys must be in time order, which the map doesn't guarantee
+	TArray<TPair<float, float>> SortedKeys;
+	SortedKeys.Reserve(TimeValueMap.Num());
+	for (const TPair<float, float>& Itr : TimeValueMap)
 	{
-		FRichCurveKey& Key = OutKeys.AddDefaulted_GetRef();
-		Key.Time = Itr.Key;
-		Key.Value = Itr.Value;
-		Key.InterpMode = InterpMode;
-		Key.TangentMode = RCTM_Auto;
-		Key.TangentWeightMode = RCTWM_WeightedNone;
-		Key.ArriveTangent = 0.f;
-		Key.LeaveTangent = 0.f;
+		SortedKeys.Add(Itr);
 	}
+	SortedKeys.Sort([](const TPair<float, float>& A, const TPair<float, float>& B) { return A.Key < B.Key; });
 
-	const FRichCurveKey FirstKey = OutKeys[0];
-	const FRichCurveKey LastKey  = OutKeys.Last();
-	FRichCurveKey PrevKey = FirstKey;
-	FRichCurveKey NextKey = OutKeys[1];
+	TArray<float> Times;
+	TArray<float> Values;
+	Times.SetNumUninitialized(SortedKeys.Num());
+	Values.SetNumUninitialized(SortedKeys.Num());
+	for (int32 KeyIndex = 0; KeyIndex < SortedKeys.Num(); ++KeyIndex)
+	{
+		Times[KeyIndex] = SortedKeys[KeyIndex].Key;
+		Values[KeyIndex] = SortedKeys[KeyIndex].Value;
+	}
 
-	int32 Key = 0;
-	constexpr float OneThird = 1.0f / 3.0f;
+	FSimpleAnimCurveKeyBuilder::BuildKeys(InterpMode, Times, Values, OutKeys);
+}
 
-	for (FRichCurveKey& ThisKey : OutKeys)
+void USimpleAnimEditorLib::BuildAutoCubicKeys(const TArray<float>& Times, const TArray<float>& Values,
+	TArray<FRichCurveKey>& OutKeys)
+{
+	OutKeys.Reset();
+	if (Times.Num() == Values.Num())
 	{
-		if (OutKeys.IsValidIndex(Key + 1))
-		{
-			NextKey = OutKeys[Key + 1];
-		}
-		
-		// Calculate a tangent weight based upon tangent and time difference
-		// Calculate arrive tangent weight
-		if (ThisKey != FirstKey)
-		{
-			const float X = ThisKey.Time - PrevKey.Time;
-			const float Y = ThisKey.ArriveTangent * X;
-			ThisKey.ArriveTangentWeight = FMath::Sqrt(X*X + Y*Y) * OneThird;
-		}
-		
-		// Calculate leave weight
-		if(ThisKey != LastKey)
-		{
-			const float X = NextKey.Time - ThisKey.Time;
-			const float Y = ThisKey.LeaveTangent *X;
-			ThisKey.LeaveTangentWeight = FMath::Sqrt(X*X + Y*Y) * OneThird;
-		}
-		
-		PrevKey = ThisKey;
-		Key++;
+		FSimpleAnimCurveKeyBuilder::BuildKeys(RCIM_Cubic, Times, Values, OutKeys);
 	}
+}
 
-	AutoSetTangents(OutKeys);
+void USimpleAnimEditorLib::BuildAutoLinearKeys(const TArray<float>& Times, const TArray<float>& Values,
+	TArray<FRichCurveKey>& OutKeys)
+{
+	OutKeys.Reset();
+	if (Times.Num() == Values.Num())
+	{
+		FSimpleAnimCurveKeyBuilder::BuildKeys(RCIM_Linear, Times, Values, OutKeys);
+	}
 }
 
 bool USimpleAnimEditorLib::IsLoopingAnimation(const UAnimSequence* Animation, float DetectionThreshold,
 	bool bIgnoreRootMotion, bool bIgnorePelvis)
 {
-	// Only do this if the animation is looping
-	TArray<FTransform> FirstPose;
-	TArray<FTransform> LastPose;
-	GetPoseForTime(Animation, FirstPose, 0.f);
-	GetPoseForTime(Animation, LastPose, Animation->GetPlayLength());
-	if (bIgnoreRootMotion)
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(IsLoopingAnimation);
+
+	const USkeleton* Skeleton = Animation ? Animation->GetSkeleton() : nullptr;
+	if (!Skeleton)
+	{
+		return false;
+	}
+
+	// The threshold was compared against every translation, quaternion and scale component
+	FSimpleAnimLoopSettings Settings;
+	Settings.TranslationTolerance = DetectionThreshold;
+	Settings.ScaleTolerance = DetectionThreshold;
+
+	// Quaternion components can't differ by 2 or more, so rotation was never compared with the default threshold
+	// Otherwise use the angle that moves the quaternion by the threshold
+	Settings.AngularTolerance = DetectionThreshold >= 2.f ? 180.f :
+		FMath::RadiansToDegrees(4.f * FMath::Asin(DetectionThreshold * 0.5f));
+
+	const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
+	if (bIgnoreRootMotion && RefSkeleton.GetRawBoneNum() > 0)
 	{
-		FirstPose.RemoveAt(0);  // Don't compare root
-		LastPose.RemoveAt(0);
+		Settings.IgnoredBones.Add(RefSkeleton.GetBoneName(0));  // Don't compare root
 	}
-	if (bIgnorePelvis)
+	if (bIgnorePelvis && RefSkeleton.GetRawBoneNum() > 1)
 	{
-		const int32 PelvisIndex = bIgnoreRootMotion ? 0 : 1;
-		FirstPose.RemoveAt(PelvisIndex);  // Don't compare pelvis, for when animator accidentally put root motion there instead...
-		LastPose.RemoveAt(PelvisIndex);
+		Settings.IgnoredBones.Add(RefSkeleton.GetBoneName(1));  // Don't compare pelvis, for when animator accidentally put root motion there instead...
 	}
-	return CompareBoneTransforms(FirstPose, LastPose, DetectionThreshold);
+
+	FSimpleAnimLoopReport Report;
+	return DetectLoop(Animation, Settings, Report);
+}
+
+bool USimpleAnimEditorLib::DetectLoop(const UAnimSequence* Animation, const FSimpleAnimLoopSettings& Settings,
+	FSimpleAnimLoopReport& OutReport)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(DetectLoop);
+
+	OutReport = FSimpleAnimLoopReport();
+
+	const FSimpleAnimPoseSampler Sampler(Animation);
+	if (!Sampler.IsValid())
+	{
+		return false;
+	}
+
+	// Every bone that isn't ignored, in reference skeleton order
+	const FReferenceSkeleton& RefSkeleton = Sampler.GetSkeleton()->GetReferenceSkeleton();
+	TArray<int32> BoneIndices;
+	BoneIndices.Reserve(Sampler.GetNumBones());
+	for (int32 BoneIndex = 0; BoneIndex < Sampler.GetNumBones(); ++BoneIndex)
+	{
+		if (!Settings.IgnoredBones.Contains(RefSkeleton.GetBoneName(BoneIndex)))
+		{
+			BoneIndices.Add(BoneIndex);
+		}
+	}
+
+	// Sample both ends of the animation
+	TArray<FTransform> Pose;
+	FSimpleAnimPoseBuffer FirstPose;
+	FSimpleAnimPoseBuffer LastPose;
+	Sampler.SampleLocal(0.f, Pose);
+	FirstPose.SetFromTransforms(Pose, BoneIndices);
+	Sampler.SampleLocal(Animation->GetPlayLength(), Pose);
+	LastPose.SetFromTransforms(Pose, BoneIndices);
+
+	const FSimpleAnimPoseCompare::FThresholds Thresholds(Settings);
+	FSimpleAnimPoseDiff Diff;
+	const int32 FirstFailure = FSimpleAnimPoseCompare::Compare(FirstPose, LastPose, Thresholds, Settings.bStopAtFirstFailure, &Diff);
+
+	// Only the bones compared are reported, which stops at the first failure when exiting early
+	const int32 NumReported = FMath::Min(Diff.NumCompared, BoneIndices.Num());
+	OutReport.Bones.SetNum(NumReported);
+	for (int32 Index = 0; Index < NumReported; ++Index)
+	{
+		FSimpleAnimLoopBoneError& BoneError = OutReport.Bones[Index];
+		BoneError.BoneName = RefSkeleton.GetBoneName(BoneIndices[Index]);
+		BoneError.TranslationError = FMath::Sqrt(Diff.TranslationSq[Index]);
+		BoneError.AngularError = FMath::RadiansToDegrees(2.f * FMath::Acos(FMath::Min(Diff.AbsQuatDot[Index], 1.f)));
+		BoneError.ScaleError = Diff.ScaleDelta[Index];
+		BoneError.bWithinTolerance = Diff.TranslationSq[Index] <= Thresholds.MaxTranslationSq &&
+			Diff.AbsQuatDot[Index] >= Thresholds.MinAbsQuatDot && Diff.ScaleDelta[Index] <= Thresholds.MaxScaleDelta;
+	}
+
+	OutReport.bLooping = FirstFailure == INDEX_NONE;
+	return OutReport.bLooping;
+}
+
+bool USimpleAnimEditorLib::FindBestLoopPoints(const UAnimSequence* Animation, const FSimpleAnimLoopSearchSettings& Settings,
+	FSimpleAnimLoopPoints& OutLoopPoints)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(FindBestLoopPoints);
+
+	OutLoopPoints = FSimpleAnimLoopPoints();
+
+	const FSimpleAnimPoseSampler Sampler(Animation);
+	const int32 NumFrames = Animation ? Animation->GetNumberOfSampledKeys() : 0;
+	const int32 MinLoopFrames = FMath::Max(1, Settings.MinLoopFrames);
+	const int32 MaxLoopFrames = Settings.MaxLoopFrames > 0 ? FMath::Max(Settings.MaxLoopFrames, MinLoopFrames) : NumFrames;
+	if (!Sampler.IsValid() || NumFrames <= MinLoopFrames)
+	{
+		return false;
+	}
+
+	// Every bone that isn't ignored, in reference skeleton order
+	const FReferenceSkeleton& RefSkeleton = Sampler.GetSkeleton()->GetReferenceSkeleton();
+	TArray<int32> BoneIndices;
+	BoneIndices.Reserve(Sampler.GetNumBones());
+	for (int32 BoneIndex = 0; BoneIndex < Sampler.GetNumBones(); ++BoneIndex)
+	{
+		if (!Settings.IgnoredBones.Contains(RefSkeleton.GetBoneName(BoneIndex)))
+		{
+			BoneIndices.Add(BoneIndex);
+		}
+	}
+	if (BoneIndices.Num() == 0)
+	{
+		return false;
+	}
+
+	// Sample every frame once, frames are independent so they can be sampled on any thread
+	const FFrameRate FrameRate = Animation->GetSamplingFrameRate();
+	TArray<FSimpleAnimPoseBuffer> PoseCache;
+	PoseCache.SetNum(NumFrames);
+	ParallelFor(NumFrames, [&](int32 Frame)
+	{
+		TArray<FTransform> Pose;
+		Sampler.SampleLocal(static_cast<float>(FrameRate.AsSeconds(Frame)), Pose);
+		PoseCache[Frame].SetFromTransforms(Pose, BoneIndices);
+	});
+
+	// Best end frame for each start frame, rows are independent so each is searched on its own thread
+	// Only the best of each row is kept, so memory doesn't grow with the square of the frame count
+	const int32 NumRows = NumFrames - MinLoopFrames;
+	TArray<float> RowBestDistance;
+	TArray<int32> RowBestEndFrame;
+	RowBestDistance.Init(UE_MAX_FLT, NumRows);
+	RowBestEndFrame.Init(INDEX_NONE, NumRows);
+	ParallelFor(NumRows, [&](int32 StartFrame)
+	{
+		const int32 LastEndFrame = FMath::Min(NumFrames - 1, StartFrame + MaxLoopFrames);
+		for (int32 EndFrame = StartFrame + MinLoopFrames; EndFrame <= LastEndFrame; ++EndFrame)
+		{
+			// Anything worse than the row's best so far is abandoned early
+			const float Distance = FSimpleAnimPoseCompare::Distance(PoseCache[StartFrame], PoseCache[EndFrame],
+				Settings.TranslationWeight, Settings.RotationWeight, RowBestDistance[StartFrame]);
+			if (Distance < RowBestDistance[StartFrame])
+			{
+				RowBestDistance[StartFrame] = Distance;
+				RowBestEndFrame[StartFrame] = EndFrame;
+			}
+		}
+	});
+
+	// Earliest start frame wins ties, so results don't depend on thread timing
+	int32 BestStartFrame = INDEX_NONE;
+	for (int32 StartFrame = 0; StartFrame < NumRows; ++StartFrame)
+	{
+		if (RowBestEndFrame[StartFrame] != INDEX_NONE &&
+			(BestStartFrame == INDEX_NONE || RowBestDistance[StartFrame] < RowBestDistance[BestStartFrame]))
+		{
+			BestStartFrame = StartFrame;
+		}
+	}
+
+	if (BestStartFrame == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutLoopPoints.StartFrame = BestStartFrame;
+	OutLoopPoints.EndFrame = RowBestEndFrame[BestStartFrame];
+	OutLoopPoints.Error = RowBestDistance[BestStartFrame] / BoneIndices.Num();
+	return true;
 }
 
 bool USimpleAnimEditorLib::CompareBoneTransforms(const TArray<FTransform>& TransformsA,
@@ -196,73 +348,93 @@ bool USimpleAnimEditorLib::CompareBoneTransforms(const TArray<FTransform>& Trans
 	return true;
 }
 
+bool USimpleAnimEditorLib::SamplePoses(const UAnimSequenceBase* Animation, const TArray<float>& Times,
+	const TArray<FName>& BoneNames, ESimpleAnimPoseSpace Space, TArray<TArray<FTransform>>& OutPoses,
+	const FTransform& ComponentToWorld)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(SamplePoses);
+
+	OutPoses.Reset();
+
+	const FSimpleAnimPoseSampler Sampler(Animation);
+	if (!Sampler.IsValid())
+	{
+		return false;
+	}
+
+	// Resolve bone names once, rather than once per time
+	TArray<int32> BoneIndices;
+	if (BoneNames.Num() > 0)
+	{
+		const FReferenceSkeleton& RefSkeleton = Sampler.GetSkeleton()->GetReferenceSkeleton();
+		BoneIndices.Reserve(BoneNames.Num());
+		for (const FName& BoneName : BoneNames)
+		{
+			BoneIndices.Add(RefSkeleton.FindRawBoneIndex(BoneName));
+		}
+	}
+
+	OutPoses.SetNum(Times.Num());
+	TArray<FTransform> Pose;
+	for (int32 TimeIndex = 0; TimeIndex < Times.Num(); ++TimeIndex)
+	{
+		TArray<FTransform>& OutPose = OutPoses[TimeIndex];
+		if (BoneIndices.Num() == 0)
+		{
+			Sampler.Sample(Times[TimeIndex], Space, OutPose, ComponentToWorld);
+			continue;
+		}
+
+		Sampler.Sample(Times[TimeIndex], Space, Pose, ComponentToWorld);
+		OutPose.SetNumUninitialized(BoneIndices.Num());
+		for (int32 Index = 0; Index < BoneIndices.Num(); ++Index)
+		{
+			const int32 BoneIndex = BoneIndices[Index];
+			OutPose[Index] = BoneIndex != INDEX_NONE ? Pose[BoneIndex] : FTransform::Identity;
+		}
+	}
+
+	return true;
+}
+
 void USimpleAnimEditorLib::GetPoseForTime(const UAnimSequenceBase* Animation, TArray<FTransform>& Transforms,
 	float Time)
 {
-	// Initialize the array of transforms
-	const FReferenceSkeleton& RefSkeleton = Animation->GetSkeleton()->GetReferenceSkeleton();
-	const int32 NumBones = RefSkeleton.GetRawBoneNum();
-	Transforms.SetNum(NumBones);
-
-	// Iterate through each bone track and get the transform at the specified time
-	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	TArray<TArray<FTransform>> Poses;
+	if (SamplePoses(Animation, { Time }, {}, ESimpleAnimPoseSpace::Local, Poses))
+	{
+		Transforms = MoveTemp(Poses[0]);
+	}
+	else
 	{
-		const FName BoneName = RefSkeleton.GetBoneName(BoneIndex);
-		FTransform BoneTransform;
-		GetBonePoseForTime(Animation, BoneName, Time, BoneTransform);
-		Transforms[BoneIndex] = BoneTransform;
+		Transforms.Reset();
 	}
 }
 
 void USimpleAnimEditorLib::GetBonePoseForTime(const UAnimSequenceBase* Animation, FName BoneName, float Time, FTransform& Pose)
 {
 	Pose.SetIdentity();
-	TArray<FName> BoneNameArray;
 	TArray<FTransform> PoseArray;
-	BoneNameArray.Add(BoneName);
-	GetBonePosesForTimeInternal(Animation, BoneNameArray, Time, PoseArray);
-	Pose = PoseArray[0];
+	GetBonePosesForTimeInternal(Animation, { BoneName }, Time, PoseArray);
+	if (PoseArray.Num() > 0)
+	{
+		Pose = PoseArray[0];
+	}
 }
 
 void USimpleAnimEditorLib::GetBonePosesForTimeInternal(const UAnimSequenceBase* Animation, TArray<FName> BoneNames,
 	float Time, TArray<FTransform>& Poses)
 {
-	Poses.Empty(BoneNames.Num());
-	if (Animation && Animation->GetSkeleton())
+	Poses.Reset();
+	if (BoneNames.Num() == 0)
 	{
-		Poses.AddDefaulted(BoneNames.Num());
+		return;
+	}
 
-		if (BoneNames.Num())
-		{
-			TArray<FName> TrackNames;
-			Animation->GetDataModel()->GetBoneTrackNames(TrackNames);
-			
-			for (int32 BoneNameIndex = 0; BoneNameIndex < BoneNames.Num(); ++BoneNameIndex)
-			{
-				const FName& BoneName = BoneNames[BoneNameIndex];
-				if (TrackNames.Contains(BoneName))
-				{
-					const FAnimPoseEvaluationOptions EvaluationOptions = FAnimPoseEvaluationOptions();
-					FAnimPose AnimPose;
-    
-					UAnimPoseExtensions::GetAnimPoseAtTime(Animation, Time, EvaluationOptions, AnimPose);
-					Poses[BoneNameIndex] = UAnimPoseExtensions::GetBonePose(AnimPose, BoneName, EAnimPoseSpaces::Local);	
-				}
-				else
-				{
-					// otherwise, get ref pose if exists
-					const FReferenceSkeleton& RefSkeleton = Animation->GetSkeleton()->GetReferenceSkeleton();
-					const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
-					if (BoneIndex != INDEX_NONE)
-					{
-						Poses[BoneNameIndex] = RefSkeleton.GetRefBonePose()[BoneIndex];
-					}
-					else
-					{
-						Poses[BoneNameIndex] = FTransform::Identity;
-					}
-				}			
-			}
-		}
+	// Bones that aren't animated are returned in their ref pose, and missing bones as identity
+	TArray<TArray<FTransform>> SampledPoses;
+	if (SamplePoses(Animation, { Time }, BoneNames, ESimpleAnimPoseSpace::Local, SampledPoses))
+	{
+		Poses = MoveTemp(SampledPoses[0]);
 	}
 }
@@ -0,0 +1,178 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimFingerprintCache.h"
+
+#include "AnimationModifier.h"
+#include "AnimationModifiersAssetUserData.h"
+#include "SimpleAnimStats.h"
+#include "SimpleAnimationDeveloperSettings.h"
+#include "Animation/AnimBoneCompressionSettings.h"
+#include "Animation/AnimCurveCompressionSettings.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/Skeleton.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace SimpleAnimFingerprintCache
+{
+	struct FCache
+	{
+		TMap<FString, uint64> Fingerprints;
+		bool bLoaded = false;
+		bool bDirty = false;
+	};
+
+	static FCache& GetCache()
+	{
+		static FCache Cache;
+		if (!Cache.bLoaded)
+		{
+			Cache.bLoaded = true;
+
+			// One Key=Fingerprint line per animation and operation
+			TArray<FString> Lines;
+			FFileHelper::LoadFileToStringArray(Lines, *FSimpleAnimFingerprintCache::GetCacheFilename());
+			for (const FString& Line : Lines)
+			{
+				FString Key;
+				FString Value;
+				if (Line.Split(TEXT("="), &Key, &Value, ESearchCase::CaseSensitive, ESearchDir::FromEnd))
+				{
+					Cache.Fingerprints.Add(MoveTemp(Key), FCString::Strtoui64(*Value, nullptr, 16));
+				}
+			}
+		}
+		return Cache;
+	}
+
+	static FString GetKey(const UAnimSequence* Animation, FName Operation)
+	{
+		return Animation->GetPathName() + TEXT("|") + Operation.ToString();
+	}
+}
+
+bool FSimpleAnimFingerprintCache::IsEnabled()
+{
+	return USimpleAnimationDeveloperSettings::Get()->bUseFingerprintCache;
+}
+
+uint64 FSimpleAnimFingerprintCache::HashString(const FString& Text, uint64 Seed)
+{
+	return CityHash64WithSeed(reinterpret_cast<const char*>(*Text), Text.Len() * sizeof(TCHAR), Seed);
+}
+
+uint64 FSimpleAnimFingerprintCache::HashObject(const UObject* Object, uint64 Seed)
+{
+	if (!IsValid(Object))
+	{
+		return Seed;
+	}
+
+	// Exported text doesn't contain pointers, so the hash is the same from one session to the next
+	FString Text = Object->GetClass()->GetPathName();
+	for (TFieldIterator<FProperty> It(Object->GetClass()); It; ++It)
+	{
+		if (It->HasAnyPropertyFlags(CPF_Transient | CPF_DuplicateTransient))
+		{
+			continue;
+		}
+
+		for (int32 Index = 0; Index < It->ArrayDim; ++Index)
+		{
+			Text += TEXT("|") + It->GetName() + TEXT("=");
+			It->ExportText_InContainer(Index, Text, Object, nullptr, const_cast<UObject*>(Object), PPF_None);
+		}
+	}
+	return HashString(Text, Seed);
+}
+
+uint64 FSimpleAnimFingerprintCache::Fingerprint(const UAnimSequence* Animation, uint64 ParamsHash)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(Fingerprint);
+
+	// Raw data
+	const FGuid DataGuid = Animation->GetDataModel()->GenerateGuid();
+	uint64 Hash = HashString(DataGuid.ToString(), ParamsHash);
+
+	// Skeleton, which modifiers resolve bones through
+	if (const USkeleton* Skeleton = Animation->GetSkeleton())
+	{
+		Hash = HashString(Skeleton->GetGuid().ToString(), Hash);
+	}
+
+	// Modifiers, and their class defaults, which change when the modifier is edited
+	if (const UAnimationModifiersAssetUserData* UserData = const_cast<UAnimSequence*>(Animation)->GetAssetUserData<UAnimationModifiersAssetUserData>())
+	{
+		for (const UAnimationModifier* Modifier : UserData->GetAnimationModifierInstances())
+		{
+			if (IsValid(Modifier))
+			{
+				Hash = HashObject(Modifier, Hash);
+				Hash = HashObject(Modifier->GetClass()->GetDefaultObject(), Hash);
+			}
+		}
+	}
+
+	// Compression
+	Hash = HashObject(Animation->BoneCompressionSettings, Hash);
+	Hash = HashObject(Animation->CurveCompressionSettings, Hash);
+	return Hash;
+}
+
+bool FSimpleAnimFingerprintCache::IsUpToDate(const UAnimSequence* Animation, FName Operation, uint64 ParamsHash)
+{
+	if (!IsEnabled() || !IsValid(Animation))
+	{
+		return false;
+	}
+
+	const uint64* Cached = SimpleAnimFingerprintCache::GetCache().Fingerprints.Find(SimpleAnimFingerprintCache::GetKey(Animation, Operation));
+	return Cached && *Cached == Fingerprint(Animation, ParamsHash);
+}
+
+void FSimpleAnimFingerprintCache::MarkUpToDate(const UAnimSequence* Animation, FName Operation, uint64 ParamsHash)
+{
+	if (!IsEnabled() || !IsValid(Animation))
+	{
+		return;
+	}
+
+	SimpleAnimFingerprintCache::FCache& Cache = SimpleAnimFingerprintCache::GetCache();
+	Cache.Fingerprints.Add(SimpleAnimFingerprintCache::GetKey(Animation, Operation), Fingerprint(Animation, ParamsHash));
+	Cache.bDirty = true;
+}
+
+void FSimpleAnimFingerprintCache::Flush()
+{
+	SimpleAnimFingerprintCache::FCache& Cache = SimpleAnimFingerprintCache::GetCache();
+	if (!Cache.bDirty)
+	{
+		return;
+	}
+
+	FString Text;
+	for (const TPair<FString, uint64>& Fingerprint : Cache.Fingerprints)
+	{
+		Text += FString::Printf(TEXT("%s=%016llx\n"), *Fingerprint.Key, Fingerprint.Value);
+	}
+
+	if (FFileHelper::SaveStringToFile(Text, *GetCacheFilename()))
+	{
+		Cache.bDirty = false;
+	}
+}
+
+void FSimpleAnimFingerprintCache::Clear()
+{
+	SimpleAnimFingerprintCache::FCache& Cache = SimpleAnimFingerprintCache::GetCache();
+	Cache.Fingerprints.Reset();
+	Cache.bDirty = true;
+	Flush();
+}
+
+FString FSimpleAnimFingerprintCache::GetCacheFilename()
+{
+	return FPaths::ProjectSavedDir() / TEXT("SimpleAnimation") / TEXT("Fingerprints.txt");
+}
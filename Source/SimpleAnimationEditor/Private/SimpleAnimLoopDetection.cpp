@@ -0,0 +1,183 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimLoopDetection.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SimpleAnimLoopDetection)
+
+void FSimpleAnimPoseBuffer::Reset(int32 InNumBones)
+{
+	NumBones = InNumBones;
+	NumPaddedBones = Align(InNumBones, 4);
+	Data.SetNumUninitialized(NumStreams * NumPaddedBones);
+
+	// Padding is identity in every buffer, so it never fails a comparison or adds to a distance
+	for (int32 Stream = 0; Stream < NumStreams; ++Stream)
+	{
+		const float Identity = (Stream == RotW || Stream >= ScaleX) ? 1.f : 0.f;
+		float* Values = GetStream(static_cast<EStream>(Stream));
+		for (int32 BoneIndex = NumBones; BoneIndex < NumPaddedBones; ++BoneIndex)
+		{
+			Values[BoneIndex] = Identity;
+		}
+	}
+}
+
+void FSimpleAnimPoseBuffer::SetFromTransforms(const TArray<FTransform>& Transforms, const TArray<int32>& BoneIndices)
+{
+	Reset(BoneIndices.Num());
+
+	float* Streams[NumStreams];
+	for (int32 Stream = 0; Stream < NumStreams; ++Stream)
+	{
+		Streams[Stream] = GetStream(static_cast<EStream>(Stream));
+	}
+
+	for (int32 Index = 0; Index < NumBones; ++Index)
+	{
+		const FTransform& Transform = Transforms[BoneIndices[Index]];
+		const FVector Translation = Transform.GetTranslation();
+		const FQuat Rotation = Transform.GetRotation();
+		const FVector Scale = Transform.GetScale3D();
+
+		Streams[PosX][Index] = static_cast<float>(Translation.X);
+		Streams[PosY][Index] = static_cast<float>(Translation.Y);
+		Streams[PosZ][Index] = static_cast<float>(Translation.Z);
+		Streams[RotX][Index] = static_cast<float>(Rotation.X);
+		Streams[RotY][Index] = static_cast<float>(Rotation.Y);
+		Streams[RotZ][Index] = static_cast<float>(Rotation.Z);
+		Streams[RotW][Index] = static_cast<float>(Rotation.W);
+		Streams[ScaleX][Index] = static_cast<float>(Scale.X);
+		Streams[ScaleY][Index] = static_cast<float>(Scale.Y);
+		Streams[ScaleZ][Index] = static_cast<float>(Scale.Z);
+	}
+}
+
+FSimpleAnimPoseCompare::FThresholds::FThresholds(const FSimpleAnimLoopSettings& Settings)
+	: MaxTranslationSq(FMath::Square(Settings.TranslationTolerance))
+	// q and -q are the same rotation, so compare |q1.q2| against cos(half the angle)
+	, MinAbsQuatDot(Settings.AngularTolerance >= 180.f ? -1.f : FMath::Cos(FMath::DegreesToRadians(Settings.AngularTolerance) * 0.5f))
+	, MaxScaleDelta(Settings.ScaleTolerance)
+{}
+
+int32 FSimpleAnimPoseCompare::Compare(const FSimpleAnimPoseBuffer& A, const FSimpleAnimPoseBuffer& B,
+	const FThresholds& Thresholds, bool bEarlyExit, FSimpleAnimPoseDiff* OutDiff)
+{
+	check(A.GetNumBones() == B.GetNumBones());
+	const int32 NumPaddedBones = A.GetNumPaddedBones();
+
+	if (OutDiff)
+	{
+		OutDiff->TranslationSq.SetNumUninitialized(NumPaddedBones);
+		OutDiff->AbsQuatDot.SetNumUninitialized(NumPaddedBones);
+		OutDiff->ScaleDelta.SetNumUninitialized(NumPaddedBones);
+		OutDiff->NumCompared = 0;
+	}
+
+	const VectorRegister4Float MaxTranslationSq = VectorSetFloat1(Thresholds.MaxTranslationSq);
+	const VectorRegister4Float MinAbsQuatDot = VectorSetFloat1(Thresholds.MinAbsQuatDot);
+	const VectorRegister4Float MaxScaleDelta = VectorSetFloat1(Thresholds.MaxScaleDelta);
+
+	auto Load = [](const FSimpleAnimPoseBuffer& Buffer, FSimpleAnimPoseBuffer::EStream Stream, int32 BoneIndex)
+	{
+		return VectorLoadAligned(Buffer.GetStream(Stream) + BoneIndex);
+	};
+
+	auto Delta = [&A, &B, &Load](FSimpleAnimPoseBuffer::EStream Stream, int32 BoneIndex)
+	{
+		return VectorSubtract(Load(A, Stream, BoneIndex), Load(B, Stream, BoneIndex));
+	};
+
+	int32 FirstFailure = INDEX_NONE;
+	for (int32 BoneIndex = 0; BoneIndex < NumPaddedBones; BoneIndex += 4)
+	{
+		// Squared distance
+		const VectorRegister4Float DX = Delta(FSimpleAnimPoseBuffer::PosX, BoneIndex);
+		const VectorRegister4Float DY = Delta(FSimpleAnimPoseBuffer::PosY, BoneIndex);
+		const VectorRegister4Float DZ = Delta(FSimpleAnimPoseBuffer::PosZ, BoneIndex);
+		const VectorRegister4Float TranslationSq = VectorMultiplyAdd(DX, DX, VectorMultiplyAdd(DY, DY, VectorMultiply(DZ, DZ)));
+
+		// Absolute quaternion dot product
+		VectorRegister4Float QuatDot = VectorMultiply(Load(A, FSimpleAnimPoseBuffer::RotX, BoneIndex), Load(B, FSimpleAnimPoseBuffer::RotX, BoneIndex));
+		QuatDot = VectorMultiplyAdd(Load(A, FSimpleAnimPoseBuffer::RotY, BoneIndex), Load(B, FSimpleAnimPoseBuffer::RotY, BoneIndex), QuatDot);
+		QuatDot = VectorMultiplyAdd(Load(A, FSimpleAnimPoseBuffer::RotZ, BoneIndex), Load(B, FSimpleAnimPoseBuffer::RotZ, BoneIndex), QuatDot);
+		QuatDot = VectorMultiplyAdd(Load(A, FSimpleAnimPoseBuffer::RotW, BoneIndex), Load(B, FSimpleAnimPoseBuffer::RotW, BoneIndex), QuatDot);
+		const VectorRegister4Float AbsQuatDot = VectorAbs(QuatDot);
+
+		// Largest difference of any scale axis
+		const VectorRegister4Float ScaleDelta = VectorMax(VectorAbs(Delta(FSimpleAnimPoseBuffer::ScaleX, BoneIndex)),
+			VectorMax(VectorAbs(Delta(FSimpleAnimPoseBuffer::ScaleY, BoneIndex)), VectorAbs(Delta(FSimpleAnimPoseBuffer::ScaleZ, BoneIndex))));
+
+		if (OutDiff)
+		{
+			VectorStoreAligned(TranslationSq, OutDiff->TranslationSq.GetData() + BoneIndex);
+			VectorStoreAligned(AbsQuatDot, OutDiff->AbsQuatDot.GetData() + BoneIndex);
+			VectorStoreAligned(ScaleDelta, OutDiff->ScaleDelta.GetData() + BoneIndex);
+			OutDiff->NumCompared = BoneIndex + 4;
+		}
+
+		const VectorRegister4Float FailMask = VectorBitwiseOr(VectorCompareGT(TranslationSq, MaxTranslationSq),
+			VectorBitwiseOr(VectorCompareLT(AbsQuatDot, MinAbsQuatDot), VectorCompareGT(ScaleDelta, MaxScaleDelta)));
+
+		const uint32 FailBits = static_cast<uint32>(VectorMaskBits(FailMask));
+		if (FailBits != 0 && FirstFailure == INDEX_NONE)
+		{
+			FirstFailure = BoneIndex + static_cast<int32>(FMath::CountTrailingZeros(FailBits));
+			if (bEarlyExit)
+			{
+				break;
+			}
+		}
+	}
+
+	return FirstFailure;
+}
+
+float FSimpleAnimPoseCompare::Distance(const FSimpleAnimPoseBuffer& A, const FSimpleAnimPoseBuffer& B,
+	float TranslationWeight, float RotationWeight, float MaxDistance)
+{
+	check(A.GetNumBones() == B.GetNumBones());
+	const int32 NumPaddedBones = A.GetNumPaddedBones();
+
+	const VectorRegister4Float TranslationWeights = VectorSetFloat1(TranslationWeight);
+	const VectorRegister4Float RotationWeights = VectorSetFloat1(RotationWeight);
+	const VectorRegister4Float One = VectorOne();
+
+	auto Load = [](const FSimpleAnimPoseBuffer& Buffer, FSimpleAnimPoseBuffer::EStream Stream, int32 BoneIndex)
+	{
+		return VectorLoadAligned(Buffer.GetStream(Stream) + BoneIndex);
+	};
+
+	auto Delta = [&A, &B, &Load](FSimpleAnimPoseBuffer::EStream Stream, int32 BoneIndex)
+	{
+		return VectorSubtract(Load(A, Stream, BoneIndex), Load(B, Stream, BoneIndex));
+	};
+
+	// Check against MaxDistance every few groups, horizontal sums aren't free
+	constexpr int32 BonesPerCheck = 16;
+
+	VectorRegister4Float Sum = VectorZero();
+	for (int32 BoneIndex = 0; BoneIndex < NumPaddedBones; BoneIndex += 4)
+	{
+		const VectorRegister4Float DX = Delta(FSimpleAnimPoseBuffer::PosX, BoneIndex);
+		const VectorRegister4Float DY = Delta(FSimpleAnimPoseBuffer::PosY, BoneIndex);
+		const VectorRegister4Float DZ = Delta(FSimpleAnimPoseBuffer::PosZ, BoneIndex);
+		const VectorRegister4Float TranslationSq = VectorMultiplyAdd(DX, DX, VectorMultiplyAdd(DY, DY, VectorMultiply(DZ, DZ)));
+
+		VectorRegister4Float QuatDot = VectorMultiply(Load(A, FSimpleAnimPoseBuffer::RotX, BoneIndex), Load(B, FSimpleAnimPoseBuffer::RotX, BoneIndex));
+		QuatDot = VectorMultiplyAdd(Load(A, FSimpleAnimPoseBuffer::RotY, BoneIndex), Load(B, FSimpleAnimPoseBuffer::RotY, BoneIndex), QuatDot);
+		QuatDot = VectorMultiplyAdd(Load(A, FSimpleAnimPoseBuffer::RotZ, BoneIndex), Load(B, FSimpleAnimPoseBuffer::RotZ, BoneIndex), QuatDot);
+		QuatDot = VectorMultiplyAdd(Load(A, FSimpleAnimPoseBuffer::RotW, BoneIndex), Load(B, FSimpleAnimPoseBuffer::RotW, BoneIndex), QuatDot);
+		const VectorRegister4Float RotationError = VectorMax(VectorSubtract(One, VectorAbs(QuatDot)), VectorZero());
+
+		Sum = VectorMultiplyAdd(TranslationSq, TranslationWeights, Sum);
+		Sum = VectorMultiplyAdd(RotationError, RotationWeights, Sum);
+
+		if ((BoneIndex + 4) % BonesPerCheck == 0 && VectorGetComponent(VectorDot4(Sum, One), 0) > MaxDistance)
+		{
+			break;
+		}
+	}
+
+	return VectorGetComponent(VectorDot4(Sum, One), 0);
+}
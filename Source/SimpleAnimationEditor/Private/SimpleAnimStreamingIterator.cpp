@@ -0,0 +1,151 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimStreamingIterator.h"
+
+#include "FileHelpers.h"
+#include "SimpleAnimStats.h"
+#include "Animation/AnimSequence.h"
+#include "Misc/ScopedSlowTask.h"
+#include "UObject/UObjectGlobals.h"
+
+#define LOCTEXT_NAMESPACE "SimpleAnimStreamingIterator"
+
+FSimpleAnimStreamingResult FSimpleAnimStreamingIterator::ForEachWindow(const TArray<FAssetData>& Assets,
+	const FOperation& Operation, const FSimpleAnimStreamingSettings& Settings)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(StreamingForEachWindow);
+
+	FSimpleAnimStreamingResult Result;
+	Result.NumAssets = Assets.Num();
+
+	const int32 WindowSize = FMath::Max(1, Settings.WindowSize);
+
+	FScopedSlowTask SlowTask(Assets.Num(), LOCTEXT("ForEachWindow", "Processing animations..."), Settings.bShowProgress);
+	if (Settings.bShowProgress)
+	{
+		SlowTask.MakeDialog(true);
+	}
+
+	TArray<UAnimSequence*> Animations;
+	TArray<UAnimSequence*> Rooted;
+	TSet<const UPackage*> AlreadyDirty;
+	for (int32 WindowStart = 0; WindowStart < Assets.Num(); WindowStart += WindowSize)
+	{
+		if (SlowTask.ShouldCancel())
+		{
+			Result.bCancelled = true;
+			break;
+		}
+
+		const int32 WindowEnd = FMath::Min(WindowStart + WindowSize, Assets.Num());
+		SlowTask.EnterProgressFrame(WindowEnd - WindowStart, FText::Format(
+			LOCTEXT("ForEachWindow_Progress", "Processing animations {0} - {1} of {2}"),
+			FText::AsNumber(WindowStart + 1), FText::AsNumber(WindowEnd), FText::AsNumber(Assets.Num())));
+
+		LoadWindow(MakeArrayView(Assets).Slice(WindowStart, WindowEnd - WindowStart), Animations, Rooted, AlreadyDirty, Result);
+
+		if (Animations.Num() > 0 && !Operation(Animations))
+		{
+			Result.bOperationFailed = true;
+		}
+
+		FinishWindow(Animations, Rooted, AlreadyDirty, Settings.bSave, Result);
+		Result.NumWindows++;
+	}
+
+	return Result;
+}
+
+FSimpleAnimStreamingResult FSimpleAnimStreamingIterator::RunBulkOperation(const TArray<FAssetData>& Assets,
+	const FSimpleAnimBulkSettings& BulkSettings, const FSimpleAnimStreamingSettings& Settings)
+{
+	return ForEachWindow(Assets, [&BulkSettings](const TArray<UAnimSequence*>& Animations)
+	{
+		return USimpleAnimAssetEditorLib::RunBulkOperation(Animations, BulkSettings);
+	}, Settings);
+}
+
+void FSimpleAnimStreamingIterator::LoadWindow(TConstArrayView<FAssetData> Assets, TArray<UAnimSequence*>& OutAnimations,
+	TArray<UAnimSequence*>& OutRooted, TSet<const UPackage*>& OutAlreadyDirty, FSimpleAnimStreamingResult& Result)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(StreamingLoadWindow);
+
+	OutAnimations.Reset();
+	OutRooted.Reset();
+	OutAlreadyDirty.Reset();
+
+	// Request the whole window before waiting on any of it, so the loader can batch and overlap the reads
+	TArray<int32> RequestIds;
+	for (const FAssetData& Asset : Assets)
+	{
+		if (!Asset.FastGetAsset(false))
+		{
+			RequestIds.Add(LoadPackageAsync(Asset.PackageName.ToString()));
+		}
+	}
+
+	for (const int32 RequestId : RequestIds)
+	{
+		FlushAsyncLoading(RequestId);
+	}
+
+	// Nothing can be garbage collected between the loads finishing and here
+	for (const FAssetData& Asset : Assets)
+	{
+		UAnimSequence* Animation = Cast<UAnimSequence>(Asset.FastGetAsset(false));
+		if (!Animation)
+		{
+			Result.FailedToLoad.Add(Asset.PackageName.ToString());
+			continue;
+		}
+
+		OutAnimations.Add(Animation);
+		if (Animation->GetPackage()->IsDirty())
+		{
+			OutAlreadyDirty.Add(Animation->GetPackage());
+		}
+		if (!Animation->IsRooted())
+		{
+			Animation->AddToRoot();
+			OutRooted.Add(Animation);
+		}
+	}
+}
+
+void FSimpleAnimStreamingIterator::FinishWindow(const TArray<UAnimSequence*>& Animations, const TArray<UAnimSequence*>& Rooted,
+	const TSet<const UPackage*>& AlreadyDirty, bool bSave, FSimpleAnimStreamingResult& Result)
+{
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(StreamingFinishWindow);
+
+	// Packages with unsaved edits from before the window aren't ours to save, or to report as changed
+	TArray<UPackage*> DirtyPackages;
+	for (const UAnimSequence* Animation : Animations)
+	{
+		UPackage* Package = Animation->GetPackage();
+		if (Package->IsDirty() && !AlreadyDirty.Contains(Package) && !DirtyPackages.Contains(Package))
+		{
+			DirtyPackages.Add(Package);
+			Result.Modified.Add(Package->GetName());
+		}
+	}
+
+	if (bSave && DirtyPackages.Num() > 0)
+	{
+		UEditorLoadingAndSavingUtils::SavePackages(DirtyPackages, true);
+		for (const UPackage* Package : DirtyPackages)
+		{
+			(Package->IsDirty() ? Result.FailedToSave : Result.Saved).Add(Package->GetName());
+		}
+	}
+
+	for (UAnimSequence* Animation : Rooted)
+	{
+		Animation->RemoveFromRoot();
+	}
+
+	// Nothing references this window anymore, so it is released before the next one loads
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,224 @@
+﻿// Copyright (c) Jared Taylor
+
+
+#include "SimpleAnimationCommandlet.h"
+
+#include "CollectionManagerModule.h"
+#include "ICollectionManager.h"
+#include "JsonObjectConverter.h"
+#include "Animation/AnimSequence.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SimpleAnimationCommandlet)
+
+DEFINE_LOG_CATEGORY_STATIC(LogSimpleAnimCommandlet, Log, All);
+
+namespace SimpleAnimCommandlet
+{
+	static TArray<FString> ParseList(const FString& Params, const TCHAR* Key)
+	{
+		TArray<FString> Entries;
+		FString Value;
+		if (FParse::Value(*Params, Key, Value, false))
+		{
+			Value.ParseIntoArray(Entries, TEXT(","));
+		}
+		return Entries;
+	}
+
+	static TArray<TSharedPtr<FJsonValue>> ToJsonArray(const TArray<FString>& Strings)
+	{
+		TArray<TSharedPtr<FJsonValue>> Values;
+		for (const FString& String : Strings)
+		{
+			Values.Add(MakeShared<FJsonValueString>(String));
+		}
+		return Values;
+	}
+}
+
+USimpleAnimationCommandlet::USimpleAnimationCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 USimpleAnimationCommandlet::Main(const FString& Params)
+{
+	FSimpleAnimBulkSettings Settings;
+	if (!ParseSettings(Params, Settings))
+	{
+		return 1;
+	}
+
+	if (Settings.Operation == ESimpleAnimBulkOperation::None)
+	{
+		UE_LOG(LogSimpleAnimCommandlet, Error, TEXT("No operation given, pass -Operation= or a -SettingsFile= containing one"));
+		return 1;
+	}
+
+	FSimpleAnimStreamingSettings StreamingSettings;
+	FParse::Value(*Params, TEXT("BatchSize="), StreamingSettings.WindowSize);
+	StreamingSettings.WindowSize = FMath::Max(1, StreamingSettings.WindowSize);
+	StreamingSettings.bSave = !FParse::Param(*Params, TEXT("NoSave"));
+	StreamingSettings.bShowProgress = false;
+
+	FString SummaryFile = FPaths::ProjectSavedDir() / TEXT("SimpleAnimation") / TEXT("SimpleAnimationCommandlet.json");
+	FParse::Value(*Params, TEXT("Summary="), SummaryFile);
+
+	const TArray<FAssetData> Assets = GatherAssets(Params);
+	const FString OperationName = StaticEnum<ESimpleAnimBulkOperation>()->GetNameStringByValue(static_cast<int64>(Settings.Operation));
+	UE_LOG(LogSimpleAnimCommandlet, Display, TEXT("Running %s on %d animations in batches of %d"), *OperationName,
+		Assets.Num(), StreamingSettings.WindowSize);
+
+	const double StartTime = FPlatformTime::Seconds();
+	int32 NumProcessed = 0;
+	const FSimpleAnimStreamingResult Result = FSimpleAnimStreamingIterator::ForEachWindow(Assets,
+		[&Settings, &NumProcessed, &Assets](const TArray<UAnimSequence*>& Animations)
+		{
+			NumProcessed += Animations.Num();
+			UE_LOG(LogSimpleAnimCommandlet, Display, TEXT("Processing %d animations, %d of %d"), Animations.Num(),
+				NumProcessed, Assets.Num());
+			return USimpleAnimAssetEditorLib::RunBulkOperation(Animations, Settings);
+		}, StreamingSettings);
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogSimpleAnimCommandlet, Display, TEXT("%s modified %d of %d animations in %.1f seconds, %d saved, %d failed to load, %d failed to save"),
+		*OperationName, Result.Modified.Num(), Result.NumAssets, Seconds, Result.Saved.Num(),
+		Result.FailedToLoad.Num(), Result.FailedToSave.Num());
+
+	const bool bWroteSummary = WriteSummary(SummaryFile, Settings, Result, Seconds);
+	const bool bSucceeded = bWroteSummary && !Result.bOperationFailed && Result.FailedToLoad.Num() == 0 &&
+		Result.FailedToSave.Num() == 0;
+	return bSucceeded ? 0 : 1;
+}
+
+bool USimpleAnimationCommandlet::ParseSettings(const FString& Params, FSimpleAnimBulkSettings& OutSettings)
+{
+	FString SettingsFile;
+	if (FParse::Value(*Params, TEXT("SettingsFile="), SettingsFile))
+	{
+		FString Json;
+		if (!FFileHelper::LoadFileToString(Json, *SettingsFile) || !FJsonObjectConverter::JsonObjectStringToUStruct(Json, &OutSettings))
+		{
+			UE_LOG(LogSimpleAnimCommandlet, Error, TEXT("Failed to read settings from %s"), *SettingsFile);
+			return false;
+		}
+	}
+
+	// Any property can be overridden from the command line, in the same format as the editor's copy and paste
+	for (TFieldIterator<FProperty> It(FSimpleAnimBulkSettings::StaticStruct()); It; ++It)
+	{
+		FString Value;
+		if (FParse::Value(*Params, *(It->GetName() + TEXT("=")), Value, false) &&
+			!It->ImportText_InContainer(*Value, &OutSettings, nullptr, PPF_None))
+		{
+			UE_LOG(LogSimpleAnimCommandlet, Error, TEXT("Invalid value %s for %s"), *Value, *It->GetName());
+			return false;
+		}
+	}
+	return true;
+}
+
+TArray<FAssetData> USimpleAnimationCommandlet::GatherAssets(const FString& Params)
+{
+	using namespace SimpleAnimCommandlet;
+
+	IAssetRegistry& AssetRegistry = *IAssetRegistry::Get();
+	TArray<FAssetData> Assets;
+
+	const TArray<FString> Paths = ParseList(Params, TEXT("Paths="));
+	if (Paths.Num() > 0)
+	{
+		// The asset registry doesn't scan by itself in commandlets
+		AssetRegistry.ScanPathsSynchronous(Paths, true);
+
+		TArray<FName> PackagePaths;
+		for (const FString& Path : Paths)
+		{
+			PackagePaths.Add(*Path);
+		}
+		Assets = USimpleAnimAssetEditorLib::GetAnimationAssetData(PackagePaths);
+	}
+
+	const TArray<FString> Collections = ParseList(Params, TEXT("Collections="));
+	if (Collections.Num() > 0)
+	{
+		// Collections can reference assets anywhere
+		AssetRegistry.SearchAllAssets(true);
+
+		const ICollectionManager& CollectionManager = FCollectionManagerModule::GetModule().Get();
+		for (const FString& Collection : Collections)
+		{
+			TArray<FSoftObjectPath> ObjectPaths;
+			if (!CollectionManager.GetAssetsInCollection(*Collection, ECollectionShareType::CST_All, ObjectPaths))
+			{
+				UE_LOG(LogSimpleAnimCommandlet, Warning, TEXT("Collection %s not found"), *Collection);
+				continue;
+			}
+
+			for (const FSoftObjectPath& ObjectPath : ObjectPaths)
+			{
+				const FAssetData Asset = AssetRegistry.GetAssetByObjectPath(ObjectPath);
+				if (Asset.IsValid() && Asset.GetClass() && Asset.GetClass()->IsChildOf<UAnimSequence>())
+				{
+					Assets.Add(Asset);
+				}
+			}
+		}
+	}
+
+	// Paths and collections overlap, and a stable order keeps batches the same from one run to the next
+	Assets.Sort([](const FAssetData& A, const FAssetData& B)
+	{
+		return A.PackageName.LexicalLess(B.PackageName);
+	});
+
+	TArray<FAssetData> UniqueAssets;
+	UniqueAssets.Reserve(Assets.Num());
+	for (FAssetData& Asset : Assets)
+	{
+		if (UniqueAssets.Num() == 0 || UniqueAssets.Last().PackageName != Asset.PackageName)
+		{
+			UniqueAssets.Add(MoveTemp(Asset));
+		}
+	}
+	return UniqueAssets;
+}
+
+bool USimpleAnimationCommandlet::WriteSummary(const FString& Filename, const FSimpleAnimBulkSettings& Settings,
+	const FSimpleAnimStreamingResult& Result, double Seconds)
+{
+	using namespace SimpleAnimCommandlet;
+
+	const TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetObjectField(TEXT("Settings"), FJsonObjectConverter::UStructToJsonObject(Settings));
+	Json->SetNumberField(TEXT("Assets"), Result.NumAssets);
+	Json->SetNumberField(TEXT("Batches"), Result.NumWindows);
+	Json->SetNumberField(TEXT("Seconds"), Seconds);
+	Json->SetBoolField(TEXT("OperationFailed"), Result.bOperationFailed);
+	Json->SetArrayField(TEXT("Modified"), ToJsonArray(Result.Modified));
+	Json->SetArrayField(TEXT("Saved"), ToJsonArray(Result.Saved));
+	Json->SetArrayField(TEXT("FailedToLoad"), ToJsonArray(Result.FailedToLoad));
+	Json->SetArrayField(TEXT("FailedToSave"), ToJsonArray(Result.FailedToSave));
+
+	FString JsonString;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonString);
+	FJsonSerializer::Serialize(Json, Writer);
+
+	if (!FFileHelper::SaveStringToFile(JsonString, *Filename))
+	{
+		UE_LOG(LogSimpleAnimCommandlet, Error, TEXT("Failed to write summary to %s"), *Filename);
+		return false;
+	}
+
+	UE_LOG(LogSimpleAnimCommandlet, Display, TEXT("Wrote summary to %s"), *Filename);
+	return true;
+}
@@ -1,15 +1,17 @@
 ﻿#include "SimpleAnimationEditor.h"
 
+#include "SimpleAnimAssetRegistryTags.h"
+
 #define LOCTEXT_NAMESPACE "FSimpleAnimationEditorModule"
 
 void FSimpleAnimationEditorModule::StartupModule()
 {
-    
+    FSimpleAnimAssetRegistryTags::Register();
 }
 
 void FSimpleAnimationEditorModule::ShutdownModule()
 {
-    
+    FSimpleAnimAssetRegistryTags::Unregister();
 }
 
 #undef LOCTEXT_NAMESPACE
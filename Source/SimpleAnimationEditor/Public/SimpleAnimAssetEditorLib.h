@@ -3,10 +3,140 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Animation/AnimData/CurveIdentifier.h"
+#include "SimpleAnimDependencyGraph.h"
+#include "AssetRegistry/AssetData.h"
+#include "Curves/RichCurve.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "SimpleAnimAssetEditorLib.generated.h"
 
+class UAnimCurveCompressionSettings;
 class UAnimationModifier;
+class UAnimationModifiersAssetUserData;
+class USkeletalMesh;
+
+DECLARE_DYNAMIC_DELEGATE_OneParam(FSimpleAnimAsyncComplete, int32, NumChanged);
+
+/**
+ * A float curve to add to, or remove from, an animation
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimCurveSpec
+{
+	GENERATED_BODY()
+
+	FSimpleAnimCurveSpec(FName InCurveName = NAME_None, bool bInRemove = false)
+		: CurveName(InCurveName)
+		, bRemove(bInRemove)
+	{}
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	FName CurveName;
+
+	/** Keys the curve will have, replacing any it already has */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(EditCondition="!bRemove"))
+	TArray<FRichCurveKey> Keys;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(EditCondition="!bRemove"))
+	bool bMetaDataCurve = true;
+
+	/** Remove the curve instead of adding it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bRemove = false;
+};
+
+/**
+ * Result of reducing the float curve keys of one animation
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimCurveReduction
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	TObjectPtr<UAnimSequence> Animation = nullptr;
+
+	/** Num float curves that had keys removed */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	int32 NumCurvesReduced = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	int32 NumKeysBefore = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	int32 NumKeysAfter = 0;
+
+	/** Raw key data removed from the animation, compressed curve data shrinks by a varying amount */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation, meta=(ForceUnits="Bytes"))
+	int32 EstimatedBytesSaved = 0;
+};
+
+/**
+ * USimpleAnimAssetEditorLib bulk edits that can be run by name, see USimpleAnimAssetEditorLib::RunBulkOperation()
+ */
+UENUM(BlueprintType)
+enum class ESimpleAnimBulkOperation : uint8
+{
+	None							UMETA(Hidden),
+	ApplyPreviewMesh,
+	SetAnimRootLock					UMETA(ToolTip="Uses bEnable"),
+	SetAnimEnableRootMotion			UMETA(ToolTip="Uses bEnable"),
+	ApplyAnimFloatCurves			UMETA(ToolTip="Uses CurveSpecs"),
+	ReduceAnimCurveKeys				UMETA(ToolTip="Uses CurveTolerance"),
+	SetCompressionType				UMETA(ToolTip="Uses CurveCompressionSettings"),
+	CompressAnimations				UMETA(ToolTip="Uses TargetPlatformNames"),
+	RemoveAllAnimCurves,
+	RemoveAllAnimNotifies,
+	RemoveAllAnimModifiers,
+	AddAnimModifiers				UMETA(ToolTip="Uses Modifiers"),
+	SetImportRotation				UMETA(ToolTip="Uses ImportRotation and bReimport"),
+};
+
+/**
+ * A bulk edit and its parameters, only the parameters the operation uses are read
+ * Can be read from JSON, or from the command line with one -Property=Value per property
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimBulkSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	ESimpleAnimBulkOperation Operation = ESimpleAnimBulkOperation::None;
+
+	/** SetAnimRootLock, SetAnimEnableRootMotion */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bEnable = true;
+
+	/** ApplyAnimFloatCurves */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	TArray<FSimpleAnimCurveSpec> CurveSpecs;
+
+	/** ReduceAnimCurveKeys */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0"))
+	float CurveTolerance = 0.001f;
+
+	/** SetCompressionType */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	TSoftObjectPtr<UAnimCurveCompressionSettings> CurveCompressionSettings;
+
+	/** CompressAnimations */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	TArray<FString> TargetPlatformNames;
+
+	/** AddAnimModifiers */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	TArray<TSoftClassPtr<UAnimationModifier>> Modifiers;
+
+	/** SetImportRotation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	FRotator ImportRotation = FRotator::ZeroRotator;
+
+	/** SetImportRotation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bReimport = false;
+};
+
 /**
  * Functions for editor action utilities for animation assets
  */
@@ -20,9 +150,23 @@ public:
 	UFUNCTION(BlueprintCallable, Category="Editor|Animation", CallInEditor, meta=(DeterminesOutputType="CastToClass", DynamicOutputParam="Result"))
 	static void EditorCastArrayChecked(TArray<UObject*> ArrayToCast, TSubclassOf<UObject> CastToClass, TArray<UObject*>& Result);
 
+	/** @return Every animation sequence in the given paths, from the asset registry without loading any of them */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
+	static TArray<FAssetData> GetAnimationAssetData(const TArray<FName>& PackagePaths, bool bRecursive = true);
+
 	/** Apply default mesh set in USimpleAnimationDeveloperSettings as the preview mesh */
 	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
 	static void ApplyPreviewMesh(const TArray<UAnimSequence*>& Animations);
+
+	/**
+	 * ApplyPreviewMesh without blocking the editor
+	 * Only animations whose asset registry data shows a different preview mesh are loaded. The mesh and those animations
+	 * are streamed in BatchSize at a time, and each batch is updated as it arrives, with progress and cancellation in a notification
+	 * @param OnComplete Called with the num animations changed, once finished or cancelled
+	 * @return Num animations that will be loaded
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation", meta=(AutoCreateRefTerm="OnComplete"))
+	static int32 ApplyPreviewMeshAsync(const TArray<FAssetData>& Assets, const FSimpleAnimAsyncComplete& OnComplete, int32 BatchSize = 100);
 	
 	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
 	static void SetAnimRootLock(bool bLock, const TArray<UAnimSequence*>& Animations);
@@ -35,6 +179,25 @@ public:
 
 	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
 	static void RemoveAnimFloatCurve(const TArray<UAnimSequence*>& Animations, FName CurveName);
+
+	/**
+	 * Add and remove many float curves at once
+	 * Every change to an animation is made inside a single data controller bracket, so the animation is only rebuilt
+	 * and recompressed once. Curves that already match their spec are left alone, and animations without any
+	 * changes aren't modified at all
+	 * @return Num animations that changed
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
+	static int32 ApplyAnimFloatCurves(const TArray<UAnimSequence*>& Animations, const TArray<FSimpleAnimCurveSpec>& CurveSpecs);
+
+	/**
+	 * Remove float curve keys that can be removed without any curve moving more than Tolerance from its current value
+	 * Useful for baked curves, which have a key every frame. Every curve of an animation is set inside a single data
+	 * controller bracket, so the animation is only recompressed once
+	 * @return One entry per valid animation, including those that had nothing to remove
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
+	static TArray<FSimpleAnimCurveReduction> ReduceAnimCurveKeys(const TArray<UAnimSequence*>& Animations, float Tolerance = 0.001f);
 	
 	/** @return Any animations whose compression type changed */
 	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
@@ -42,6 +205,19 @@ public:
 	
 	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
 	static void CompressAnimations(const TArray<UAnimSequence*>& Animations);
+
+	/**
+	 * Compress animations with up to MaxConcurrent compression tasks in flight at once
+	 * Progress and failures are reported to the AssetCheck message log
+	 * @param TargetPlatformNames Additional platforms to compress for in the same pass, e.g. "Linux". The running platform is always compressed
+	 * @param MaxConcurrent Max compression tasks in flight at once
+	 * @param TimeoutSeconds Any single compression task taking longer than this is cancelled and reported as a failure
+	 * @param bShowProgress Show a modal progress dialog that can cancel the remaining tasks
+	 * @return Any animations that failed to compress
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation", meta=(AutoCreateRefTerm="TargetPlatformNames"))
+	static TArray<UAnimSequence*> CompressAnimationsAsync(const TArray<UAnimSequence*>& Animations, const TArray<FString>& TargetPlatformNames,
+		int32 MaxConcurrent = 16, float TimeoutSeconds = 300.f, bool bShowProgress = false);
 	
 	/** Modifying an animation while its editor is open isn't always safe */
 	UFUNCTION(BlueprintCallable, Category="Editor|Animation", CallInEditor)
@@ -59,9 +235,75 @@ public:
 	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
 	static void AddAnimModifiers(const TArray<UAnimSequence*>& Animations, const TArray<TSubclassOf<UAnimationModifier>>& Modifiers);
 
+	/**
+	 * Pipelined AddAnimModifiers for large animation sets
+	 * Every modifier is applied to an animation inside a single data controller bracket, so the animation is only
+	 * recompressed once all of its modifiers have finished. Animations are processed in chunks with a cancellable progress dialog
+	 * @return Num animations processed, less than the input if cancelled
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
+	static int32 AddAnimModifiersBatched(const TArray<UAnimSequence*>& Animations, const TArray<TSubclassOf<UAnimationModifier>>& Modifiers, int32 ChunkSize = 50);
+
 	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
 	static void SetImportRotation(const TArray<UAnimSequence*>& Animations, FRotator Rotation, bool bReimport=false);
 	
+	/**
+	 * ApplyPreviewMesh, but only loads the animations whose asset registry data shows they need changing
+	 * @return Num animations that had to be loaded
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation", meta=(DisplayName="Apply Preview Mesh (Registry)"))
+	static int32 ApplyPreviewMesh_Registry(const TArray<FAssetData>& Assets);
+
+	/**
+	 * SetAnimRootLock, but only loads the animations whose asset registry data shows they need changing
+	 * @return Num animations that had to be loaded
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation", meta=(DisplayName="Set Anim Root Lock (Registry)"))
+	static int32 SetAnimRootLock_Registry(bool bLock, const TArray<FAssetData>& Assets);
+
+	/**
+	 * SetAnimEnableRootMotion, but only loads the animations whose asset registry data shows they need changing
+	 * @return Num animations that had to be loaded
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation", meta=(DisplayName="Set Anim Enable Root Motion (Registry)"))
+	static int32 SetAnimEnableRootMotion_Registry(bool bEnableRootMotion, const TArray<FAssetData>& Assets);
+
+	/**
+	 * SetCompressionTypeForAnimations, but only loads the animations whose asset registry data shows they need changing
+	 * @return Any animations whose compression type changed
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation", meta=(DisplayName="Set Compression Type For Animations (Registry)"))
+	static TArray<UAnimSequence*> SetCompressionTypeForAnimations_Registry(const TArray<FAssetData>& Assets, UAnimCurveCompressionSettings* CurveCompressionSettings);
+
+	/**
+	 * Load and dirty the animations saved before our asset registry tags existed, so saving them adds the tags
+	 * The _Registry variants have to load untagged animations every run until this has been done and they've been saved
+	 * @return Num animations dirtied
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
+	static int32 AddMissingAssetRegistryTags(const TArray<FAssetData>& Assets);
+
+	/**
+	 * Run the bulk edit named by Settings.Operation, for running bulk edits from data such as USimpleAnimationCommandlet
+	 * @return False if the operation is missing a required parameter
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
+	static bool RunBulkOperation(const TArray<UAnimSequence*>& Animations, const FSimpleAnimBulkSettings& Settings);
+
+	/**
+	 * RunBulkOperation for animation sets too large to load at once, see FSimpleAnimStreamingIterator
+	 * Animations are loaded WindowSize at a time, and each window is saved and garbage collected before the next loads
+	 * @param bSave Without saving, each window's changes are lost when it is garbage collected
+	 * @return Num animations modified
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
+	static int32 RunBulkOperationStreaming(const TArray<FAssetData>& Assets, const FSimpleAnimBulkSettings& Settings,
+		int32 WindowSize = 100, bool bSave = true);
+
+	/** Forget the fingerprints of every animation, so the next bulk edits process everything, see USimpleAnimationDeveloperSettings::bUseFingerprintCache */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
+	static void ClearFingerprintCache();
+
 	/** Print all assets to the message log */
 	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
 	static void PrintAllAssetsToMessageLog(const TArray<UObject*>& Assets, FName LogName="AssetCheck", bool bOpenMessageLog=true);
@@ -73,11 +315,60 @@ public:
 	/** Useful for finding and validating all anims assigned to an anim blueprint */
 	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation", meta=(DisplayName="Get Asset Dependencies (String)"))
 	static TArray<FString> GetAssetDependencies(const UObject* Asset);
+
+	/**
+	 * Every package the assets depend on, directly or indirectly, each listed once, see FSimpleAnimDependencyWalker
+	 * Useful for finding every animation a set of anim blueprints pulls in, by filtering to UAnimSequence
+	 */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
+	static FSimpleAnimDependencyGraph GetAssetDependencyGraph(const TArray<UObject*>& Assets, const FSimpleAnimDependencyFilter& Filter);
+
+	/** GetAssetDependencyGraph, without loading the root assets */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category="Editor|Animation")
+	static FSimpleAnimDependencyGraph GetPackageDependencyGraph(const TArray<FName>& PackageNames, const FSimpleAnimDependencyFilter& Filter);
 	
 protected:
+	/**
+	 * @param bMarkDirty False if the caller dirties the package itself, e.g. once per batch
+	 * @return True if the animation's preview mesh changed
+	 */
+	static bool ApplyPreviewMesh_Internal(UAnimSequence* Animation, USkeletalMesh* PreviewMesh, bool bMarkDirty = true);
+
+	/**
+	 * The animations whose registry tag doesn't match the desired value, without loading any of them
+	 * Animations without the tag, and animations already loaded, are always returned so they can be checked directly
+	 */
+	static TArray<FAssetData> FilterAssetsWithTagMismatch(const TArray<FAssetData>& Assets, FName TagName, const FString& DesiredValue);
+
+	/**
+	 * Load the animations whose registry tag doesn't match the desired value
+	 * Animations without the tag, and animations already loaded, are always returned so they can be checked directly
+	 * Nothing is dirtied here, so untagged animations that already have the value stay untagged, see AddMissingAssetRegistryTags()
+	 */
+	static TArray<UAnimSequence*> LoadAnimationsWithTagMismatch(const TArray<FAssetData>& Assets, FName TagName, const FString& DesiredValue);
+
+	/**
+	 * Find the identifier of a float curve on the animation
+	 * @param bCreate Before 5.3 curve names belong to the skeleton, add the name if it doesn't exist
+	 * @return False if the curve name can't be resolved
+	 */
+	static bool GetFloatCurveId(const UAnimSequence* Animation, FName CurveName, bool bCreate, FAnimationCurveIdentifier& OutCurveId);
+
+	/** @return Fingerprint parameter hash for applying these modifiers, changes when any of the modifier classes change */
+	static uint64 HashAnimModifiers(const TArray<TSubclassOf<UAnimationModifier>>& Modifiers);
+
 	/** @return Num anim modifiers removed */
 	static int32 RemoveAllAnimModifiers_Internal(UAnimSequence* Animation);
 
+	/** @return The modifiers asset user data for the animation, created if it doesn't exist yet */
+	static UAnimationModifiersAssetUserData* GetOrCreateModifiersUserData(UAnimSequence* Animation);
+
+	/**
+	 * Reapply the modifier of this class if the animation already has one, otherwise add and apply a new instance
+	 * @return False if an error was logged while applying it, e.g. a bone missing from the skeleton
+	 */
+	static bool ApplyAnimModifier_Internal(UAnimationModifiersAssetUserData* UserData, UAnimSequence* Animation, const TSubclassOf<UAnimationModifier>& Modifier);
+
 	/** Creates a new Modifier instance to store with the current asset */
 	static UAnimationModifier* CreateModifierInstance(UObject* Outer, const UClass* InClass, UObject* Template = nullptr);
 };
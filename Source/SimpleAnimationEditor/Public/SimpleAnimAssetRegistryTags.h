@@ -0,0 +1,36 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAnimationAsset;
+
+/**
+ * Asset registry tags written for every UAnimSequence when it is saved
+ * Lets bulk edits find out whether an animation needs changing without loading it
+ * Animations that haven't been saved since these were added have no tags, and must be loaded to be checked
+ */
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimAssetRegistryTags
+{
+	static const FName ForceRootLock;
+	static const FName EnableRootMotion;
+	static const FName CurveCompressionSettings;
+	static const FName PreviewMesh;
+
+	/** Start writing our tags when assets are saved */
+	static void Register();
+	static void Unregister();
+
+	/** Tag value for a bool property */
+	static FString BoolToTag(bool bValue) { return bValue ? TEXT("True") : TEXT("False"); }
+
+	/** Tag value for an object reference, empty if there is none */
+	static FString ObjectToTag(const FSoftObjectPath& Path) { return Path.IsNull() ? FString() : Path.ToString(); }
+
+	/** @return The preview mesh assigned to the animation, without loading it */
+	static FSoftObjectPath GetPreviewMeshPath(const UAnimationAsset* Animation);
+
+private:
+	static FDelegateHandle OnGetExtraObjectTagsHandle;
+};
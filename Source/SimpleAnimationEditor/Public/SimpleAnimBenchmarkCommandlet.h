@@ -0,0 +1,70 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SimpleAnimBenchmarkCommandlet.generated.h"
+
+class UAnimSequence;
+class USkeleton;
+
+/**
+ * Times pose sampling, loop detection, UCopyIKBonesModifier, curve keying and bulk asset operations
+ * against generated skeletons and sequences, then writes the results to CSV and JSON for comparison in CI
+ *
+ * UnrealEditor-Cmd <Project> -run=SimpleAnimBenchmark -nullrhi -unattended
+ *	-Bones=64,256		Bone counts to generate skeletons with, at least 12
+ *	-Frames=60,600		Frame counts to generate sequences with
+ *	-CurveKeys=100,1000	Keys per curve for curve keying
+ *	-Sequences=20		Sequences to run bulk asset operations over
+ *	-Iterations=5		Times to run each benchmark, min, mean and max are reported
+ *	-Output=<Dir>		Defaults to Saved/SimpleAnimation/Benchmark
+ *	-Baseline=<File>	JSON from a previous run, fails if any mean is slower by more than -MaxRegression (default 0.2)
+ */
+UCLASS()
+class SIMPLEANIMATIONEDITOR_API USimpleAnimBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USimpleAnimBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	struct FBenchmarkResult
+	{
+		FString Name;
+		int32 NumBones = 0;
+		int32 NumFrames = 0;
+		int32 NumCurveKeys = 0;
+		int32 Iterations = 0;
+		double MinMs = 0.0;
+		double MeanMs = 0.0;
+		double MaxMs = 0.0;
+
+		/** Identifies the same benchmark across runs */
+		FString GetKey() const { return FString::Printf(TEXT("%s_%d_%d_%d"), *Name, NumBones, NumFrames, NumCurveKeys); }
+	};
+
+	/** Run Func Iterations times, and record its timings */
+	void Time(const FString& Name, int32 NumBones, int32 NumFrames, int32 NumCurveKeys, const TFunctionRef<void()>& Func);
+
+	/**
+	 * Skeleton with the bones UCopyIKBonesModifier copies by default, and generic chains making up the rest
+	 * Never has fewer bones than those copied by default, results report the skeleton's bone count rather than NumBones
+	 */
+	static USkeleton* CreateSkeleton(int32 NumBones);
+
+	/** Sequence animating every bone, with NumCurves float curves */
+	static UAnimSequence* CreateSequence(USkeleton* Skeleton, int32 NumFrames, int32 NumCurves);
+
+	bool WriteResults(const FString& OutputDir) const;
+
+	/** @return False if any result regressed against the baseline */
+	bool CompareToBaseline(const FString& BaselineFile, double MaxRegression) const;
+
+	int32 Iterations = 5;
+	TArray<FBenchmarkResult> Results;
+};
@@ -0,0 +1,101 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SimpleAnimDependencyGraph.generated.h"
+
+/**
+ * Limits for walking asset dependencies
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimDependencyFilter
+{
+	GENERATED_BODY()
+
+	/** Dependencies of dependencies are followed this many levels deep, 1 for direct dependencies only, 0 for no limit */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0", UIMin="0"))
+	int32 MaxDepth = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bHardReferences = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bSoftReferences = true;
+
+	/** Include /Script/ packages, which are native code and have no assets */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bIncludeScriptPackages = false;
+
+	/**
+	 * Only packages whose asset is one of these classes, or a child class, are included in the result, leave empty to include everything
+	 * Other packages are still walked through, so an anim blueprint's animations are found through its blend spaces
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	TArray<TSubclassOf<UObject>> Classes;
+};
+
+/**
+ * A package in a dependency graph
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimDependencyNode
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	FName PackageName = NAME_None;
+
+	/** Class of the package's main asset, None for script packages and packages the registry doesn't know about */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	FName AssetClass = NAME_None;
+
+	/** Fewest references from any root, 0 for roots */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	int32 Depth = 0;
+
+	/** Size of the package on disk, as of the last time it was saved */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation, meta=(ForceUnits="Bytes"))
+	int64 DiskSize = 0;
+
+	/** Indices of the nodes this package directly depends on, only packages in the graph are listed */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	TArray<int32> Dependencies;
+
+	/** Num nodes in the graph that directly depend on this package */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	int32 NumReferencers = 0;
+};
+
+/**
+ * Every package reachable from a set of roots, each listed once
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimDependencyGraph
+{
+	GENERATED_BODY()
+
+	/** In the order they were reached, roots first */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	TArray<FSimpleAnimDependencyNode> Nodes;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	TMap<FName, int32> NumNodesByClass;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation, meta=(ForceUnits="Bytes"))
+	int64 TotalDiskSize = 0;
+
+	/** Num packages walked, including those the class filter left out */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	int32 NumVisited = 0;
+};
+
+/**
+ * Walks the asset registry breadth first from many roots at once
+ * Each level of the walk queries the registry in parallel, then merges into the visited set on the calling thread,
+ * so every package is only queried once and the result is the same from one run to the next
+ */
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimDependencyWalker
+{
+	static FSimpleAnimDependencyGraph Walk(TConstArrayView<FName> RootPackageNames, const FSimpleAnimDependencyFilter& Filter);
+};
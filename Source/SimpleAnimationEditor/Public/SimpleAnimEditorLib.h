@@ -3,6 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "SimpleAnimLoopDetection.h"
+#include "SimpleAnimPoseSampler.h"
 
 #include "SimpleAnimEditorLib.generated.h"
 
@@ -28,7 +30,44 @@ public:
 	static void SetAutoLinearKeyInterpolation(const TMap<float, float>& TimeValueMap, TArray<FRichCurveKey>& OutKeys);
 	
 	static void SetAutoKeyInterpolation(ERichCurveInterpMode InterpMode, const TMap<float, float>& TimeValueMap, TArray<FRichCurveKey>& OutKeys);
+
+	/**
+	 * The same as SetAutoCubicKeyInterpolation() from parallel arrays, without hashing or sorting
+	 * @param Times Key times, must be sorted ascending
+	 * @param Values Key values, one per time
+	 * @see FSimpleAnimCurveKeyBuilder to build many curves at once
+	 */
+	UFUNCTION(BlueprintPure, Category=SimpleAnimation)
+	static void BuildAutoCubicKeys(const TArray<float>& Times, const TArray<float>& Values, TArray<FRichCurveKey>& OutKeys);
+
+	/**
+	 * The same as SetAutoLinearKeyInterpolation() from parallel arrays, without hashing or sorting
+	 * @param Times Key times, must be sorted ascending
+	 * @param Values Key values, one per time
+	 */
+	UFUNCTION(BlueprintPure, Category=SimpleAnimation)
+	static void BuildAutoLinearKeys(const TArray<float>& Times, const TArray<float>& Values, TArray<FRichCurveKey>& OutKeys);
 	
+	/**
+	 * Compare the local space pose at the start and end of the animation, with separate translation, rotation and
+	 * scale tolerances. Don't use small tolerances because a proper looping animation isn't identical, but 1 frame apart
+	 * @param OutReport The difference of every bone compared
+	 * @return True if every bone not in Settings.IgnoredBones is within tolerance
+	 */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation)
+	static bool DetectLoop(const UAnimSequence* Animation, const FSimpleAnimLoopSettings& Settings, FSimpleAnimLoopReport& OutReport);
+
+	/**
+	 * Find the pair of frames the animation loops best between, e.g. to trim a mocap take to a loop
+	 * Every frame is sampled once, then every start frame is compared against every end frame within the loop length
+	 * limits in parallel
+	 * @param OutLoopPoints The best start and end frames, and the distance between their poses
+	 * @return False if the animation could not be sampled, or is too short for MinLoopFrames
+	 */
+	UFUNCTION(BlueprintCallable, Category=SimpleAnimation)
+	static bool FindBestLoopPoints(const UAnimSequence* Animation, const FSimpleAnimLoopSearchSettings& Settings,
+		FSimpleAnimLoopPoints& OutLoopPoints);
+
 	/**
 	 * @return True if the poses ( TArray<FTransform> ) at the start and end of the animation are within the Detection
 	 * Threshold. Don't use small numbers because a proper looping animation isn't identical, but 1 frame apart
@@ -37,12 +76,26 @@ public:
 	 * the difference would be extreme.
 	 *
 	 * Ignoring pelvis is sometimes useful because sometimes animations erroneously have root motion on the pelvis.
+	 *
+	 * @see DetectLoop() for separate translation and rotation tolerances
 	 */
 	static bool IsLoopingAnimation(const UAnimSequence* Animation, float DetectionThreshold = 5.f,
 		bool bIgnoreRootMotion = true, bool bIgnorePelvis = false);
 
 	static bool CompareBoneTransforms(const TArray<FTransform>& TransformsA, const TArray<FTransform>& TransformsB, float Tolerance = KINDA_SMALL_NUMBER);
 
+	/**
+	 * Evaluate the animation once per time and gather every requested bone from that evaluation
+	 * @param Times Times to sample, one pose is produced for each
+	 * @param BoneNames Bones to return, in order. Every bone is returned in reference skeleton order if empty
+	 * @param Space Space to return the transforms in
+	 * @param OutPoses One entry per time, each containing one transform per requested bone
+	 * @param ComponentToWorld Only used when Space is World
+	 * @return False if the animation could not be sampled
+	 */
+	static bool SamplePoses(const UAnimSequenceBase* Animation, const TArray<float>& Times, const TArray<FName>& BoneNames,
+		ESimpleAnimPoseSpace Space, TArray<TArray<FTransform>>& OutPoses, const FTransform& ComponentToWorld = FTransform::Identity);
+
 	static void GetPoseForTime(const UAnimSequenceBase* Animation, TArray<FTransform>& Transforms, float Time);
 	static void GetBonePoseForTime(const UAnimSequenceBase* Animation, FName BoneName, float Time, FTransform& Pose);
 	static void GetBonePosesForTimeInternal(const UAnimSequenceBase* Animation, TArray<FName> BoneNames, float Time, TArray<FTransform>& Poses);
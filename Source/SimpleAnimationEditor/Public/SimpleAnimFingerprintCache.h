@@ -0,0 +1,44 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAnimSequence;
+
+/**
+ * Fingerprints of animations as they were when a bulk edit last finished with them
+ * A fingerprint hashes the raw animation data, the skeleton, the animation modifiers and their settings, and the compression
+ * settings, along with the parameters of the bulk edit. An animation whose fingerprint hasn't changed since would get
+ * the same result again, so bulk edits skip it
+ * Saved to Saved/SimpleAnimation/Fingerprints.txt between sessions. Game thread only
+ */
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimFingerprintCache
+{
+	/** @return True if USimpleAnimationDeveloperSettings enables the cache */
+	static bool IsEnabled();
+
+	/** @return Hash of the text, for building the parameter hash of a bulk edit */
+	static uint64 HashString(const FString& Text, uint64 Seed = 0);
+
+	/** @return Hash of every non-transient property of the object, 0 for nullptr */
+	static uint64 HashObject(const UObject* Object, uint64 Seed = 0);
+
+	/** @return Fingerprint of the animation for a bulk edit with these parameters */
+	static uint64 Fingerprint(const UAnimSequence* Animation, uint64 ParamsHash);
+
+	/** @return True if Operation last finished with the animation when it had the same fingerprint, always false while disabled */
+	static bool IsUpToDate(const UAnimSequence* Animation, FName Operation, uint64 ParamsHash);
+
+	/** Record the animation's current fingerprint, call once Operation has finished with it */
+	static void MarkUpToDate(const UAnimSequence* Animation, FName Operation, uint64 ParamsHash);
+
+	/** Write any new fingerprints to disk */
+	static void Flush();
+
+	/** Forget every fingerprint, so the next bulk edits process everything */
+	static void Clear();
+
+	/** @return Path of the cache file */
+	static FString GetCacheFilename();
+};
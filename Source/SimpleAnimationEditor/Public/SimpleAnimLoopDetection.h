@@ -0,0 +1,206 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SimpleAnimLoopDetection.generated.h"
+
+/**
+ * Tolerances for comparing two poses of the same animation
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimLoopSettings
+{
+	GENERATED_BODY()
+
+	/** Max distance between the same bone in each pose */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0", ForceUnits="cm"))
+	float TranslationTolerance = 5.f;
+
+	/** Max angle between the same bone in each pose, 180 or more to ignore rotation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0", ForceUnits="Degrees"))
+	float AngularTolerance = 5.f;
+
+	/** Max difference of any scale axis between the same bone in each pose */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0"))
+	float ScaleTolerance = 0.01f;
+
+	/**
+	 * Bones that are not compared
+	 * Usually the root, because a looping run cycle with root motion ends far from where it starts, and sometimes the
+	 * pelvis, because animations erroneously have root motion on the pelvis
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	TArray<FName> IgnoredBones;
+
+	/** Stop comparing at the first bone outside of tolerance, the report will only contain the bones compared so far */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	bool bStopAtFirstFailure = true;
+};
+
+/**
+ * Difference between the same bone in two poses
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimLoopBoneError
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	FName BoneName = NAME_None;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation, meta=(ForceUnits="cm"))
+	float TranslationError = 0.f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation, meta=(ForceUnits="Degrees"))
+	float AngularError = 0.f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	float ScaleError = 0.f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	bool bWithinTolerance = true;
+};
+
+/**
+ * Result of comparing the first and last frame of an animation
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimLoopReport
+{
+	GENERATED_BODY()
+
+	/** True if every compared bone is within tolerance */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	bool bLooping = false;
+
+	/** Every bone compared, in reference skeleton order */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	TArray<FSimpleAnimLoopBoneError> Bones;
+};
+
+/**
+ * Weights and limits for searching an animation for the frames it loops best between
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimLoopSearchSettings
+{
+	GENERATED_BODY()
+
+	/** Weight of the squared distance between the same bone in each pose, in cm */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0"))
+	float TranslationWeight = 1.f;
+
+	/** Weight of 1 - |q1.q2| between the same bone in each pose, roughly a 1/8th of the squared angle in radians */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0"))
+	float RotationWeight = 1000.f;
+
+	/** Fewest frames between the start and end of the loop */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="1", UIMin="1"))
+	int32 MinLoopFrames = 10;
+
+	/** Most frames between the start and end of the loop, 0 for no limit. Long clips search much faster with a limit */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation, meta=(ClampMin="0", UIMin="0"))
+	int32 MaxLoopFrames = 0;
+
+	/** Bones that are not compared, usually the root */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=SimpleAnimation)
+	TArray<FName> IgnoredBones;
+};
+
+/**
+ * The frames an animation loops best between
+ */
+USTRUCT(BlueprintType)
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimLoopPoints
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	int32 StartFrame = INDEX_NONE;
+
+	/** Pose at this frame is the closest match to StartFrame, trim the animation to [StartFrame, EndFrame] */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	int32 EndFrame = INDEX_NONE;
+
+	/** Weighted distance between the two poses, averaged over the compared bones */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=SimpleAnimation)
+	float Error = 0.f;
+};
+
+/**
+ * Bone transforms split into one array per component, so kernels compare 4 bones at a time
+ * Each array is padded to a multiple of 4 bones with identity transforms, which never differ from each other
+ */
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimPoseBuffer
+{
+	enum EStream : uint8
+	{
+		PosX, PosY, PosZ,
+		RotX, RotY, RotZ, RotW,
+		ScaleX, ScaleY, ScaleZ,
+		NumStreams
+	};
+
+	/** Resize for NumBones, without initializing any values */
+	void Reset(int32 InNumBones);
+
+	/** Copy the transforms of BoneIndices, in order, so the first entry is bone 0 of this buffer */
+	void SetFromTransforms(const TArray<FTransform>& Transforms, const TArray<int32>& BoneIndices);
+
+	int32 GetNumBones() const { return NumBones; }
+	int32 GetNumPaddedBones() const { return NumPaddedBones; }
+
+	const float* GetStream(EStream Stream) const { return Data.GetData() + Stream * NumPaddedBones; }
+	float* GetStream(EStream Stream) { return Data.GetData() + Stream * NumPaddedBones; }
+
+private:
+	int32 NumBones = 0;
+	int32 NumPaddedBones = 0;
+	TArray<float, TAlignedHeapAllocator<16>> Data;
+};
+
+/**
+ * Per-bone differences between two poses, for every bone compared
+ */
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimPoseDiff
+{
+	TArray<float, TAlignedHeapAllocator<16>> TranslationSq;
+	TArray<float, TAlignedHeapAllocator<16>> AbsQuatDot;
+	TArray<float, TAlignedHeapAllocator<16>> ScaleDelta;
+
+	/** Bones with a difference, a multiple of 4 that may include padding */
+	int32 NumCompared = 0;
+};
+
+/**
+ * SIMD kernels for comparing pose buffers
+ */
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimPoseCompare
+{
+	/** Tolerances in the form the kernels compare against, so no square roots or trig are needed per bone */
+	struct FThresholds
+	{
+		explicit FThresholds(const FSimpleAnimLoopSettings& Settings);
+
+		float MaxTranslationSq;
+		float MinAbsQuatDot;
+		float MaxScaleDelta;
+	};
+
+	/**
+	 * Compare each bone in A to the same bone in B
+	 * @param bEarlyExit Stop after the first group of 4 bones containing a bone outside of tolerance
+	 * @param OutDiff Optional, receives the difference of every bone compared
+	 * @return Index of the first bone outside of tolerance, or INDEX_NONE if every bone is within tolerance
+	 */
+	static int32 Compare(const FSimpleAnimPoseBuffer& A, const FSimpleAnimPoseBuffer& B, const FThresholds& Thresholds,
+		bool bEarlyExit, FSimpleAnimPoseDiff* OutDiff = nullptr);
+
+	/**
+	 * Sum over every bone of TranslationWeight * |A - B|^2 + RotationWeight * (1 - |qA.qB|)
+	 * @param MaxDistance Stop summing once the distance exceeds this, the result is then only known to be greater
+	 */
+	static float Distance(const FSimpleAnimPoseBuffer& A, const FSimpleAnimPoseBuffer& B, float TranslationWeight,
+		float RotationWeight, float MaxDistance = UE_MAX_FLT);
+};
@@ -0,0 +1,74 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SimpleAnimAssetEditorLib.h"
+
+class UAnimSequence;
+class UPackage;
+
+/**
+ * Options for FSimpleAnimStreamingIterator
+ */
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimStreamingSettings
+{
+	/** Animations loaded at once */
+	int32 WindowSize = 100;
+
+	/**
+	 * Save the packages each window dirtied before moving on, otherwise their changes are lost to garbage collection
+	 * Packages that were already dirty when their window loaded are left for the user to save
+	 */
+	bool bSave = true;
+
+	/** Show a cancellable progress dialog */
+	bool bShowProgress = true;
+};
+
+/**
+ * What happened to each animation streamed through FSimpleAnimStreamingIterator, by package name
+ */
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimStreamingResult
+{
+	int32 NumAssets = 0;
+	int32 NumWindows = 0;
+	TArray<FString> Modified;
+	TArray<FString> Saved;
+	TArray<FString> FailedToLoad;
+	TArray<FString> FailedToSave;
+
+	/** The operation returned false for at least one window */
+	bool bOperationFailed = false;
+	bool bCancelled = false;
+};
+
+/**
+ * Runs bulk edits over animation sets too large to load at once
+ * Each window of animations is async loaded together and rooted, edited, saved, then unrooted and garbage collected
+ * before the next window loads, so memory holds one window at most. Game thread only
+ */
+struct SIMPLEANIMATIONEDITOR_API FSimpleAnimStreamingIterator
+{
+	/** Edits one window of animations, returning false marks the result as failed but later windows still run */
+	using FOperation = TFunctionRef<bool(const TArray<UAnimSequence*>& Animations)>;
+
+	static FSimpleAnimStreamingResult ForEachWindow(const TArray<FAssetData>& Assets, const FOperation& Operation,
+		const FSimpleAnimStreamingSettings& Settings = {});
+
+	/** ForEachWindow with any USimpleAnimAssetEditorLib bulk edit */
+	static FSimpleAnimStreamingResult RunBulkOperation(const TArray<FAssetData>& Assets, const FSimpleAnimBulkSettings& BulkSettings,
+		const FSimpleAnimStreamingSettings& Settings = {});
+
+protected:
+	/**
+	 * Load every animation in the window in one async request, and root any that weren't already
+	 * @param OutAlreadyDirty Packages that already had unsaved changes
+	 */
+	static void LoadWindow(TConstArrayView<FAssetData> Assets, TArray<UAnimSequence*>& OutAnimations,
+		TArray<UAnimSequence*>& OutRooted, TSet<const UPackage*>& OutAlreadyDirty, FSimpleAnimStreamingResult& Result);
+
+	/** Save whatever the window dirtied, except packages that were already dirty, then unroot and garbage collect it */
+	static void FinishWindow(const TArray<UAnimSequence*>& Animations, const TArray<UAnimSequence*>& Rooted,
+		const TSet<const UPackage*>& AlreadyDirty, bool bSave, FSimpleAnimStreamingResult& Result);
+};
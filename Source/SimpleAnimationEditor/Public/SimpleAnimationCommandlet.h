@@ -0,0 +1,43 @@
+﻿// Copyright (c) Jared Taylor
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SimpleAnimAssetEditorLib.h"
+#include "SimpleAnimStreamingIterator.h"
+#include "Commandlets/Commandlet.h"
+#include "SimpleAnimationCommandlet.generated.h"
+
+/**
+ * Runs any USimpleAnimAssetEditorLib bulk edit without the editor UI, see ESimpleAnimBulkOperation
+ * Animations are streamed through FSimpleAnimStreamingIterator, so memory stays flat however many there are
+ *
+ * UnrealEditor-Cmd <Project> -run=SimpleAnimation -nullrhi -unattended
+ *	-Paths=/Game/A,/Game/B		Package paths to find animation sequences in, recursively
+ *	-Collections=Name1,Name2	Collections to take animation sequences from
+ *	-SettingsFile=<File>		JSON FSimpleAnimBulkSettings, e.g. { "Operation": "SetAnimRootLock", "bEnable": true }
+ *	-Operation=SetAnimRootLock	Any FSimpleAnimBulkSettings property, overrides the JSON, e.g. -bEnable=False
+ *	-BatchSize=100				Animations loaded at once
+ *	-NoSave						Edit without saving, to see what would change
+ *	-Summary=<File>				Defaults to Saved/SimpleAnimation/SimpleAnimationCommandlet.json
+ */
+UCLASS()
+class SIMPLEANIMATIONEDITOR_API USimpleAnimationCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USimpleAnimationCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/** @return False if the settings couldn't be read */
+	static bool ParseSettings(const FString& Params, FSimpleAnimBulkSettings& OutSettings);
+
+	/** @return Animation sequences in the paths and collections given on the command line, without loading them */
+	static TArray<FAssetData> GatherAssets(const FString& Params);
+
+	static bool WriteSummary(const FString& Filename, const FSimpleAnimBulkSettings& Settings,
+		const FSimpleAnimStreamingResult& Result, double Seconds);
+};
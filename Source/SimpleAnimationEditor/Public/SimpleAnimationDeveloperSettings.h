@@ -22,4 +22,11 @@ public:
 	/** Skeletal mesh to assign when assigning the preview mesh in the editor */
 	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category=Animation)
 	TSoftObjectPtr<USkeletalMesh> DefaultSkeletalMesh;
+
+	/**
+	 * Bulk edits skip animations that haven't changed since the same edit last finished with them
+	 * Fingerprints are kept in Saved/SimpleAnimation/Fingerprints.txt, delete it or call ClearFingerprintCache to process everything again
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category=BulkEdit)
+	bool bUseFingerprintCache = false;
 };
@@ -11,6 +11,7 @@ public class SimpleAnimationEditor : ModuleRules
             {
                 "Core",
                 "DeveloperSettings",
+                "SimpleAnimation",
             }
         );
 
@@ -23,6 +24,9 @@ public class SimpleAnimationEditor : ModuleRules
                 "AnimationBlueprintLibrary", 
                 "AnimationModifiers",
                 "AssetRegistry",
+                "CollectionManager",
+                "Json",
+                "JsonUtilities",
             }
         );
     }
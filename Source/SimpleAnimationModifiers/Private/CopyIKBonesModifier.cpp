@@ -3,19 +3,118 @@
 
 #include "CopyIKBonesModifier.h"
 
-#include "AnimPose.h"
+#include "SimpleAnimPoseSampler.h"
+#include "SimpleAnimPoseWorkspace.h"
+#include "SimpleAnimStats.h"
+#include "Async/ParallelFor.h"
+#include "UObject/ObjectKey.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CopyIKBonesModifier)
 
 #define LOCTEXT_NAMESPACE "CopyIKBonesModifier"
 
+namespace CopyIKBonesModifier
+{
+	/** A bone pair resolved against a skeleton */
+	struct FCopyBoneData
+	{
+		FName SourceBoneName = NAME_None;
+		FName TargetBoneName = NAME_None;
+		int32 SourceBoneIdx = INDEX_NONE;
+		int32 TargetBoneIdx = INDEX_NONE;
+	};
+
+	/** Resolve every pair both raw bones exist for, sorted so we always modify parents first */
+	static TArray<FCopyBoneData> BuildPlan(const TArray<FCopyBonePairs>& BonesToCopy, const TFunctionRef<int32(FName)>& FindBoneIndex)
+	{
+		TArray<FCopyBoneData> Plan;
+		Plan.Reserve(BonesToCopy.Num());
+		for (const FCopyBonePairs& Pair : BonesToCopy)
+		{
+			const int32 SourceBoneIdx = FindBoneIndex(Pair.SourceBone.BoneName);
+			const int32 TargetBoneIdx = FindBoneIndex(Pair.TargetBone.BoneName);
+			if (SourceBoneIdx != INDEX_NONE && TargetBoneIdx != INDEX_NONE)
+			{
+				Plan.Add({ Pair.SourceBone.BoneName, Pair.TargetBone.BoneName, SourceBoneIdx, TargetBoneIdx });
+			}
+		}
+
+		Plan.Sort([](const FCopyBoneData& A, const FCopyBoneData& B) { return A.TargetBoneIdx < B.TargetBoneIdx; });
+		return Plan;
+	}
+
+	/** The skeleton and settings a plan was resolved for, the skeleton's guid changes whenever its hierarchy does */
+	struct FPlanKey
+	{
+		TObjectKey<USkeleton> Skeleton;
+		FGuid SkeletonGuid;
+		int32 NumBones = 0;
+
+		/** Source and target of every pair in BonesToCopy, compared in full so different settings never share a plan */
+		TArray<TPair<FName, FName>> BoneNames;
+
+		bool operator==(const FPlanKey& Other) const
+		{
+			return Skeleton == Other.Skeleton && SkeletonGuid == Other.SkeletonGuid && NumBones == Other.NumBones &&
+				BoneNames == Other.BoneNames;
+		}
+
+		friend uint32 GetTypeHash(const FPlanKey& Key)
+		{
+			uint32 Hash = HashCombine(GetTypeHash(Key.Skeleton), GetTypeHash(Key.SkeletonGuid));
+			for (const TPair<FName, FName>& Pair : Key.BoneNames)
+			{
+				Hash = HashCombine(Hash, HashCombine(GetTypeHash(Pair.Key), GetTypeHash(Pair.Value)));
+			}
+			return Hash;
+		}
+	};
+
+	/** Stale plans are never looked up again, this only stops them accumulating over a long session */
+	static constexpr int32 MaxCachedPlans = 256;
+
+	/** @return The resolved plan for this skeleton and these settings, shared by every animation that uses them. Game thread only */
+	static const TArray<FCopyBoneData>& GetPlan(const USkeleton* Skeleton, const TArray<FCopyBonePairs>& BonesToCopy)
+	{
+		static TMap<FPlanKey, TArray<FCopyBoneData>> Plans;
+
+		const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
+
+		FPlanKey Key;
+		Key.Skeleton = Skeleton;
+		Key.SkeletonGuid = Skeleton->GetGuid();
+		Key.NumBones = RefSkeleton.GetNum();
+		Key.BoneNames.Reserve(BonesToCopy.Num());
+		for (const FCopyBonePairs& Pair : BonesToCopy)
+		{
+			Key.BoneNames.Emplace(Pair.SourceBone.BoneName, Pair.TargetBone.BoneName);
+		}
+
+		if (const TArray<FCopyBoneData>* Plan = Plans.Find(Key))
+		{
+			return *Plan;
+		}
+
+		if (Plans.Num() >= MaxCachedPlans)
+		{
+			Plans.Reset();
+		}
+
+		return Plans.Add(MoveTemp(Key), BuildPlan(BonesToCopy, [&RefSkeleton](FName BoneName) { return RefSkeleton.FindRawBoneIndex(BoneName); }));
+	}
+}
+
 void UCopyIKBonesModifier::OnApply_Implementation(UAnimSequence* Animation)
 {
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(CopyIKBonesModifier);
+
 	if (!Animation)
 	{
 		return;
 	}
 
+	SIMPLEANIM_SCOPE_ASSET(Animation);
+
 	IAnimationDataController& Controller = Animation->GetController();
 #if ENGINE_MINOR_VERSION >= 2
 	const IAnimationDataModel* Model = Animation->GetDataModel();
@@ -29,100 +128,96 @@ void UCopyIKBonesModifier::OnApply_Implementation(UAnimSequence* Animation)
 		return;
 	}
 
-	// Helper structure to store data for the bones we are going to modify
-	struct FCopyBoneData
+	const USkeleton* Skeleton = Animation->GetSkeleton();
+	if (!IsValid(Skeleton))
 	{
-		FName SourceBoneName = NAME_None;
-		FName TargetBoneName = NAME_None;
-		int32 SourceBoneIdx = INDEX_NONE;
-		int32 TargetBoneIdx = INDEX_NONE;
-		FCopyBoneData(const FName& InSourceBoneName, const FName& InTargetBoneName, int32 InSourceBoneIdx, int32 InTargetBoneIdx)
-			: SourceBoneName(InSourceBoneName), TargetBoneName(InTargetBoneName), SourceBoneIdx(InSourceBoneIdx), TargetBoneIdx(InTargetBoneIdx) {}
+		UE_LOG(LogAnimation, Error, TEXT("CopyBonesModifier failed. Reason: Invalid Skeleton. Animation: %s"), *GetNameSafe(Animation));
+		return;
+	}
+
+	// Resolved once per skeleton and settings, then shared by every animation using them
+	const TArray<CopyIKBonesModifier::FCopyBoneData>& CopyBoneDataContainer = CopyIKBonesModifier::GetPlan(Skeleton, BonesToCopy);
+
+	// Temporally set ForceRootLock to true so we get the correct transforms regardless of the root motion configuration in the animation
+	TGuardValue<bool> ForceRootLockGuard(Animation->bForceRootLock, true);
+
+	// Evaluates each frame once for every bone, shared by every worker thread
+	const FSimpleAnimPoseSampler Sampler(Animation);
+	if (!Sampler.IsValid())
+	{
+		return;
+	}
+	const FFrameRate FrameRate = Animation->GetSamplingFrameRate();
+
+	// Accumulate the keys for every target bone so each track is written once
+	const int32 NumKeys = Model->GetNumberOfKeys();
+	struct FTargetBoneKeys
+	{
+		TArray<FVector> PositionalKeys;
+		TArray<FQuat> RotationalKeys;
+		TArray<FVector> ScalingKeys;
 	};
+	TArray<FTargetBoneKeys> TargetKeys;
+	TargetKeys.SetNum(CopyBoneDataContainer.Num());
+	for (FTargetBoneKeys& Keys : TargetKeys)
+	{
+		Keys.PositionalKeys.SetNumUninitialized(NumKeys);
+		Keys.RotationalKeys.SetNumUninitialized(NumKeys);
+		Keys.ScalingKeys.SetNumUninitialized(NumKeys);
+	}
 
-#if ENGINE_MINOR_VERSION >= 2
-	const USkeleton* Skeleton = Animation->GetSkeleton();
-	const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
-#endif
+	// Scratch pose for each worker thread, reused for every frame that thread evaluates
+	struct FEvaluationContext
+	{
+		FSimpleAnimPoseWorkspace Workspace;
+	};
+	TArray<FEvaluationContext> EvaluationContexts;
 
-	// Validate input
-	TArray<FCopyBoneData> CopyBoneDataContainer;
-	CopyBoneDataContainer.Reserve(BonesToCopy.Num());
-	for (const FCopyBonePairs& Pair : BonesToCopy)
+	// Get the transform of all the source bones in the desired space
+	// Frames don't depend on each other, and the sampler only reads the animation, so workers share it
+	const EParallelForFlags ParallelFlags = bParallelEvaluate ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+	ParallelForWithTaskContext(EvaluationContexts, NumKeys, [&](FEvaluationContext& Context, int32 AnimKey)
 	{
-#if ENGINE_MINOR_VERSION >= 2
-		const int32 SourceBoneIdx = RefSkeleton.FindBoneIndex(Pair.SourceBone.BoneName);
-		if (SourceBoneIdx == INDEX_NONE)
-		{
-			continue;
-		}
+		SIMPLEANIM_SCOPE_CYCLE_COUNTER(CopyIKBonesModifier_EvaluateFrame);
 
-		const int32 TargetBoneIdx = RefSkeleton.FindBoneIndex(Pair.TargetBone.BoneName);
-		if (TargetBoneIdx == INDEX_NONE)
+		// Evaluate each frame once, targets are sorted parent first so later bones see their updated parents
+		FSimpleAnimPoseWorkspace& Workspace = Context.Workspace;
+		if (!Workspace.IsInitialized())
 		{
-			continue;
-		}
-#else
-		const int32 SourceBoneIdx = Model->GetBoneTrackIndexByName(Pair.SourceBone.BoneName);
-		if (SourceBoneIdx == INDEX_NONE)
-		{
-			continue;
+			Workspace.Init(Skeleton->GetReferenceSkeleton());
 		}
+		Workspace.SetLocalPoseFromSampler(Sampler, static_cast<float>(FrameRate.AsSeconds(AnimKey)));
 
-		const int32 TargetBoneIdx = Model->GetBoneTrackIndexByName(Pair.TargetBone.BoneName);
-		if (TargetBoneIdx == INDEX_NONE)
+		for (int32 DataIndex = 0; DataIndex < CopyBoneDataContainer.Num(); ++DataIndex)
 		{
-			continue;
+			const CopyIKBonesModifier::FCopyBoneData& Data = CopyBoneDataContainer[DataIndex];
+			const FTransform BonePose = Workspace.GetTransform(Data.SourceBoneIdx, BonePoseSpace);
+
+			// UAnimDataController::UpdateBoneTrackKeys expects local transforms, only the source and target parent chains are evaluated
+			Workspace.SetTransform(Data.TargetBoneIdx, BonePose, BonePoseSpace);
+			const FTransform& BonePoseTargetLocal = Workspace.GetLocalTransform(Data.TargetBoneIdx);
+
+			// Each frame writes only its own key, so no synchronization is required
+			FTargetBoneKeys& Keys = TargetKeys[DataIndex];
+			Keys.PositionalKeys[AnimKey] = BonePoseTargetLocal.GetLocation();
+			Keys.RotationalKeys[AnimKey] = BonePoseTargetLocal.GetRotation();
+			Keys.ScalingKeys[AnimKey] = BonePoseTargetLocal.GetScale3D();
 		}
-#endif
-		
-		CopyBoneDataContainer.Add(FCopyBoneData(Pair.SourceBone.BoneName, Pair.TargetBone.BoneName, SourceBoneIdx, TargetBoneIdx));
-	}
-	
-	// Sort bones to modify so we always modify parents first
-	CopyBoneDataContainer.Sort([](const FCopyBoneData& A, const FCopyBoneData& B) { return A.TargetBoneIdx < B.TargetBoneIdx; });
-
-	// FMemMark Mark(FMemStack::Get());
-		
-	// asset to use for retarget proportions (can be either USkeletalMesh or USkeleton)
-	int32 NumRequiredBones = Animation->GetSkeleton()->GetReferenceSkeleton().GetNum();
-
-	TArray<FBoneIndexType> RequiredBoneIndexArray;
-	RequiredBoneIndexArray.AddUninitialized(NumRequiredBones);
-	for (int32 BoneIndex = 0; BoneIndex < RequiredBoneIndexArray.Num(); ++BoneIndex)
-	{
-		RequiredBoneIndexArray[BoneIndex] = BoneIndex;
-	}
-
-	// Temporally set ForceRootLock to true so we get the correct transforms regardless of the root motion configuration in the animation
-	TGuardValue<bool> ForceRootLockGuard(Animation->bForceRootLock, true);
+	}, ParallelFlags);
 
-	// Start editing animation data
+	// Start editing animation data, back on the game thread
 	constexpr bool bShouldTransact = false;
 	Controller.OpenBracket(LOCTEXT("CopyBonesModifierLib_Bracket", "Updating bones"), bShouldTransact);
 
-	// Get the transform of all the source bones in the desired space
-	const int32 NumKeys = Model->GetNumberOfKeys();
-	for (int32 AnimKey = 0; AnimKey < NumKeys; AnimKey++)
+	// Write each target track over the whole range in a single call
+	const FInt32Range KeyRangeToSet(0, NumKeys);
+	for (int32 DataIndex = 0; DataIndex < CopyBoneDataContainer.Num(); ++DataIndex)
 	{
-		for (FCopyBoneData& Data : CopyBoneDataContainer)
-		{
-			FAnimPose AnimPose;
-			UAnimPoseExtensions::GetAnimPoseAtFrame(Animation, AnimKey, FAnimPoseEvaluationOptions(), AnimPose);
-			
-			FTransform BonePose = UAnimPoseExtensions::GetBonePose(AnimPose, Data.SourceBoneName, BonePoseSpace);
-			
-			// UAnimDataController::UpdateBoneTrackKeys expects local transforms so we need to convert the source transforms to target bone local transforms first. 
-			UAnimPoseExtensions::SetBonePose(AnimPose, BonePose, Data.TargetBoneName, BonePoseSpace);
-			FTransform BonePoseTargetLocal = UAnimPoseExtensions::GetBonePose(AnimPose, Data.TargetBoneName, EAnimPoseSpaces::Local);
-			
-			const FInt32Range KeyRangeToSet(AnimKey, AnimKey + 1);
-			Controller.UpdateBoneTrackKeys(Data.TargetBoneName, KeyRangeToSet,
-				{ BonePoseTargetLocal.GetLocation() },
-				{ BonePoseTargetLocal.GetRotation() },
-				{ BonePoseTargetLocal.GetScale3D() });
-		}
+		const FTargetBoneKeys& Keys = TargetKeys[DataIndex];
+		Controller.UpdateBoneTrackKeys(CopyBoneDataContainer[DataIndex].TargetBoneName, KeyRangeToSet,
+			Keys.PositionalKeys, Keys.RotationalKeys, Keys.ScalingKeys, bShouldTransact);
 	}
+	SIMPLEANIM_INC_STAT_BY(STAT_SimpleAnim_KeysWritten, NumKeys * CopyBoneDataContainer.Num());
 
 	// Done editing animation data
 	Controller.CloseBracket(bShouldTransact);
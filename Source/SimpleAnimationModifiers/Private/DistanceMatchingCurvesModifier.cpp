@@ -0,0 +1,292 @@
+﻿// Copyright (c) Jared Taylor.
+
+
+#include "DistanceMatchingCurvesModifier.h"
+
+#include "SimpleAnimCurveKeyBuilder.h"
+#include "SimpleAnimPoseSampler.h"
+#include "SimpleAnimPoseWorkspace.h"
+#include "SimpleAnimStats.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/AnimData/IAnimationDataController.h"
+#include "Async/ParallelFor.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(DistanceMatchingCurvesModifier)
+
+#define LOCTEXT_NAMESPACE "DistanceMatchingCurvesModifier"
+
+namespace DistanceMatchingCurvesModifier
+{
+	/** Rate of change at each frame, from the frames either side, or the one neighbour on the first and last frame */
+	template<typename TDeltaFunc>
+	static void CentralRates(int32 NumFrames, float DeltaTime, TArray<float>& OutRates, TDeltaFunc&& Delta)
+	{
+		OutRates.SetNumUninitialized(NumFrames);
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			const int32 Prev = FMath::Max(Frame - 1, 0);
+			const int32 Next = FMath::Min(Frame + 1, NumFrames - 1);
+			OutRates[Frame] = Delta(Prev, Next) / (static_cast<float>(Next - Prev) * DeltaTime);
+		}
+	}
+
+	/** @return False if the curve doesn't exist and bCreate is false */
+	static bool GetCurveId(const UAnimSequence* Animation, FName CurveName, bool bCreate, FAnimationCurveIdentifier& OutCurveId)
+	{
+#if ENGINE_MINOR_VERSION >= 3
+		OutCurveId = FAnimationCurveIdentifier(CurveName, ERawCurveTrackTypes::RCT_Float);
+		return bCreate || Animation->GetDataModel()->FindFloatCurve(OutCurveId) != nullptr;
+#else
+		USkeleton* Skeleton = Animation->GetSkeleton();
+		FSmartName SmartName;
+		if (!Skeleton->GetSmartNameByName(USkeleton::AnimCurveMappingName, CurveName, SmartName))
+		{
+			if (!bCreate)
+			{
+				return false;
+			}
+			Skeleton->AddSmartNameAndModify(USkeleton::AnimCurveMappingName, CurveName, SmartName);
+		}
+
+		OutCurveId = FAnimationCurveIdentifier(SmartName, ERawCurveTrackTypes::RCT_Float);
+		return bCreate || Animation->GetDataModel()->FindFloatCurve(OutCurveId) != nullptr;
+#endif
+	}
+}
+
+TArray<FName> UDistanceMatchingCurvesModifier::GetCurveNames() const
+{
+	TArray<FName> CurveNames;
+	for (const FName& CurveName : { DistanceCurveName, SpeedCurveName, YawRateCurveName })
+	{
+		if (!CurveName.IsNone())
+		{
+			CurveNames.AddUnique(CurveName);
+		}
+	}
+	return CurveNames;
+}
+
+void UDistanceMatchingCurvesModifier::OnApply_Implementation(UAnimSequence* Animation)
+{
+	using namespace DistanceMatchingCurvesModifier;
+
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(DistanceMatchingCurvesModifier);
+
+	if (!Animation)
+	{
+		return;
+	}
+
+	SIMPLEANIM_SCOPE_ASSET(Animation);
+
+	const USkeleton* Skeleton = Animation->GetSkeleton();
+	if (!IsValid(Skeleton))
+	{
+		UE_LOG(LogAnimation, Error, TEXT("DistanceMatchingCurvesModifier failed. Reason: Invalid Skeleton. Animation: %s"), *GetNameSafe(Animation));
+		return;
+	}
+
+	const int32 NumFrames = Animation->GetNumberOfSampledKeys();
+	if (NumFrames < 2 || GetCurveNames().Num() == 0)
+	{
+		return;
+	}
+
+	const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
+	const int32 PelvisIndex = PelvisBoneName.IsNone() ? INDEX_NONE : RefSkeleton.FindRawBoneIndex(PelvisBoneName);
+
+	const FFrameRate FrameRate = Animation->GetSamplingFrameRate();
+
+	// Root and pelvis for every frame, from a single evaluation of each frame
+	TArray<FTransform> RootTransforms;
+	TArray<FVector> PelvisLocations;
+	RootTransforms.SetNumUninitialized(NumFrames);
+	PelvisLocations.SetNumZeroed(NumFrames);
+	{
+		// Root lock would remove the motion we're baking
+		TGuardValue<bool> ForceRootLockGuard(Animation->bForceRootLock, false);
+
+		// Evaluates each frame once for every bone, shared by every worker thread
+		const FSimpleAnimPoseSampler Sampler(Animation);
+
+		// Scratch pose for each worker thread, reused for every frame that thread evaluates
+		struct FEvaluationContext
+		{
+			FSimpleAnimPoseWorkspace Workspace;
+		};
+		TArray<FEvaluationContext> EvaluationContexts;
+
+		// Frames don't depend on each other, and each frame writes only its own transforms
+		const EParallelForFlags ParallelFlags = bParallelEvaluate ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+		ParallelForWithTaskContext(EvaluationContexts, NumFrames, [&](FEvaluationContext& Context, int32 Frame)
+		{
+			SIMPLEANIM_SCOPE_CYCLE_COUNTER(DistanceMatchingCurvesModifier_EvaluateFrame);
+
+			FSimpleAnimPoseWorkspace& Workspace = Context.Workspace;
+			if (!Workspace.IsInitialized())
+			{
+				Workspace.Init(RefSkeleton);
+			}
+			Workspace.SetLocalPoseFromSampler(Sampler, static_cast<float>(FrameRate.AsSeconds(Frame)));
+
+			RootTransforms[Frame] = Workspace.GetComponentTransform(0);
+			if (PelvisIndex != INDEX_NONE)
+			{
+				PelvisLocations[Frame] = Workspace.GetComponentTransform(PelvisIndex).GetLocation();
+			}
+		}, ParallelFlags);
+	}
+
+	auto Distance = [this](const FVector& A, const FVector& B)
+	{
+		return static_cast<float>(bIgnoreZ ? FVector::Dist2D(A, B) : FVector::Dist(A, B));
+	};
+
+	// Distance along the path the root takes, not the straight line between the first and last frame
+	TArray<float> Distances;
+	Distances.SetNumUninitialized(NumFrames);
+	Distances[0] = 0.f;
+	for (int32 Frame = 1; Frame < NumFrames; ++Frame)
+	{
+		Distances[Frame] = Distances[Frame - 1] + Distance(RootTransforms[Frame - 1].GetLocation(), RootTransforms[Frame].GetLocation());
+	}
+	const float TotalDistance = Distances.Last();
+
+	// Flat curves would be baked if the motion was authored on the pelvis instead of the root
+	if (PelvisIndex != INDEX_NONE && TotalDistance < PelvisMotionThreshold &&
+		Distance(PelvisLocations[0], PelvisLocations.Last()) > PelvisMotionThreshold)
+	{
+		UE_LOG(LogAnimation, Warning, TEXT("DistanceMatchingCurvesModifier: %s travels on %s instead of the root, curves will not reflect its motion"),
+			*GetNameSafe(Animation), *PelvisBoneName.ToString());
+	}
+
+	const float DeltaTime = static_cast<float>(FrameRate.AsInterval());
+
+	TArray<float> Times;
+	Times.SetNumUninitialized(NumFrames);
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		Times[Frame] = static_cast<float>(FrameRate.AsSeconds(Frame));
+	}
+
+	TArray<FName> CurveNames;
+	TArray<float> CurveTolerances;
+	TArray<TArray<float>> CurveTimes;
+	TArray<TArray<float>> CurveValues;
+
+	// Same rule as GetCurveNames(), the first curve keeps a name shared with a later one
+	auto AddCurve = [&](FName CurveName, float Tolerance)
+	{
+		if (CurveName.IsNone())
+		{
+			return false;
+		}
+		if (CurveNames.Contains(CurveName))
+		{
+			UE_LOG(LogAnimation, Warning, TEXT("DistanceMatchingCurvesModifier: %s is used by more than one curve, only the first is baked. Animation: %s"),
+				*CurveName.ToString(), *GetNameSafe(Animation));
+			return false;
+		}
+		CurveNames.Add(CurveName);
+		CurveTolerances.Add(Tolerance);
+		return true;
+	};
+
+	if (AddCurve(DistanceCurveName, DistanceTolerance))
+	{
+		if (bDistanceToEnd)
+		{
+			for (float& Value : Distances)
+			{
+				Value -= TotalDistance;
+			}
+		}
+		CurveValues.Add(MoveTemp(Distances));
+	}
+
+	if (AddCurve(SpeedCurveName, SpeedTolerance))
+	{
+		TArray<float>& Speeds = CurveValues.AddDefaulted_GetRef();
+		CentralRates(NumFrames, DeltaTime, Speeds, [&](int32 Prev, int32 Next)
+		{
+			return Distance(RootTransforms[Prev].GetLocation(), RootTransforms[Next].GetLocation());
+		});
+	}
+
+	if (AddCurve(YawRateCurveName, YawRateTolerance))
+	{
+		TArray<float>& YawRates = CurveValues.AddDefaulted_GetRef();
+		CentralRates(NumFrames, DeltaTime, YawRates, [&RootTransforms](int32 Prev, int32 Next)
+		{
+			const double PrevYaw = RootTransforms[Prev].GetRotation().Rotator().Yaw;
+			const double NextYaw = RootTransforms[Next].GetRotation().Rotator().Yaw;
+			return static_cast<float>(FRotator::NormalizeAxis(NextYaw - PrevYaw));
+		});
+	}
+
+	CurveTimes.Init(Times, CurveNames.Num());
+
+	// Key every curve in parallel, then reduce each to the tolerance for its units, then write them all in one bracket
+	TArray<TArray<FRichCurveKey>> CurveKeys;
+	FSimpleAnimCurveKeyBuilder::BuildKeysBatch(RCIM_Cubic, CurveTimes, CurveValues, CurveKeys);
+	ParallelFor(CurveKeys.Num(), [&CurveKeys, &CurveTolerances](int32 CurveIndex)
+	{
+		if (CurveTolerances[CurveIndex] > 0.f)
+		{
+			FSimpleAnimCurveKeyBuilder::ReduceKeys(CurveKeys[CurveIndex], CurveTolerances[CurveIndex]);
+		}
+	});
+
+	constexpr bool bShouldTransact = false;
+	IAnimationDataController& Controller = Animation->GetController();
+	Controller.OpenBracket(LOCTEXT("DistanceMatchingCurvesModifier_Bracket", "Baking distance matching curves"), bShouldTransact);
+
+	const int32 CurveFlags = bMetaDataCurves ? AACF_Metadata : AACF_DefaultCurve;
+	for (int32 CurveIndex = 0; CurveIndex < CurveNames.Num(); ++CurveIndex)
+	{
+		FAnimationCurveIdentifier CurveId;
+		if (!GetCurveId(Animation, CurveNames[CurveIndex], true, CurveId))
+		{
+			continue;
+		}
+
+		if (Animation->GetDataModel()->FindFloatCurve(CurveId))
+		{
+			Controller.SetCurveFlags(CurveId, CurveFlags, bShouldTransact);
+		}
+		else
+		{
+			Controller.AddCurve(CurveId, CurveFlags, bShouldTransact);
+		}
+		Controller.SetCurveKeys(CurveId, CurveKeys[CurveIndex], bShouldTransact);
+		SIMPLEANIM_INC_STAT_BY(STAT_SimpleAnim_KeysWritten, CurveKeys[CurveIndex].Num());
+	}
+
+	Controller.CloseBracket(bShouldTransact);
+}
+
+void UDistanceMatchingCurvesModifier::OnRevert_Implementation(UAnimSequence* Animation)
+{
+	if (!Animation || !IsValid(Animation->GetSkeleton()))
+	{
+		return;
+	}
+
+	constexpr bool bShouldTransact = false;
+	IAnimationDataController& Controller = Animation->GetController();
+	Controller.OpenBracket(LOCTEXT("DistanceMatchingCurvesModifier_RevertBracket", "Removing distance matching curves"), bShouldTransact);
+
+	for (const FName& CurveName : GetCurveNames())
+	{
+		FAnimationCurveIdentifier CurveId;
+		if (DistanceMatchingCurvesModifier::GetCurveId(Animation, CurveName, false, CurveId))
+		{
+			Controller.RemoveCurve(CurveId, bShouldTransact);
+		}
+	}
+
+	Controller.CloseBracket(bShouldTransact);
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,329 @@
+﻿// Copyright (c) Jared Taylor.
+
+
+#include "FootstepMarkersModifier.h"
+
+#include "AnimationBlueprintLibrary.h"
+#include "SimpleAnimPoseSampler.h"
+#include "SimpleAnimPoseWorkspace.h"
+#include "SimpleAnimStats.h"
+#include "Animation/AnimNotifies/AnimNotify.h"
+#include "Animation/AnimSequence.h"
+#include "Async/ParallelFor.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(FootstepMarkersModifier)
+
+namespace FootstepMarkersModifier
+{
+	/**
+	 * Component space positions of one foot, one array per axis
+	 * Frame N is at index N + 1, with an extrapolated frame either side so every frame has a central difference, and
+	 * padding so the last group of 4 frames can be loaded whole
+	 */
+	struct FFootSamples
+	{
+		int32 BoneIndex = INDEX_NONE;
+		TArray<float> X;
+		TArray<float> Y;
+		TArray<float> Z;
+
+		/** Frames the foot can plant on and must lift on, 4 frames per entry in the low bits */
+		TArray<uint8> PlantBits;
+		TArray<uint8> LiftBits;
+
+		bool CanPlant(int32 Frame) const { return (PlantBits[Frame >> 2] >> (Frame & 3)) & 1; }
+		bool MustLift(int32 Frame) const { return (LiftBits[Frame >> 2] >> (Frame & 3)) & 1; }
+	};
+
+	struct FContactEvent
+	{
+		int32 Frame;
+		int32 FootIndex;
+		bool bPlant;
+	};
+
+	static void PadStream(TArray<float>& Stream, int32 NumFrames)
+	{
+		Stream[0] = 2.f * Stream[1] - Stream[2];
+		Stream[NumFrames + 1] = 2.f * Stream[NumFrames] - Stream[NumFrames - 1];
+		for (int32 Index = NumFrames + 2; Index < Stream.Num(); ++Index)
+		{
+			Stream[Index] = Stream[NumFrames + 1];
+		}
+	}
+
+	/** Classify every frame of the foot against the thresholds, 4 frames at a time */
+	static void Classify(FFootSamples& Foot, int32 NumFrames, float PlantHeight, float LiftHeight, float PlantDistance,
+		float LiftDistance)
+	{
+		float MinZ = UE_MAX_FLT;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			MinZ = FMath::Min(MinZ, Foot.Z[Frame + 1]);
+		}
+
+		// Compare heights and squared distances between neighbouring frames, so no subtraction or square root per frame
+		const VectorRegister4Float PlantZ = VectorSetFloat1(MinZ + PlantHeight);
+		const VectorRegister4Float LiftZ = VectorSetFloat1(MinZ + LiftHeight);
+		const VectorRegister4Float PlantDistanceSq = VectorSetFloat1(FMath::Square(PlantDistance));
+		const VectorRegister4Float LiftDistanceSq = VectorSetFloat1(FMath::Square(LiftDistance));
+
+		const int32 NumGroups = FMath::DivideAndRoundUp(NumFrames, 4);
+		Foot.PlantBits.SetNumUninitialized(NumGroups);
+		Foot.LiftBits.SetNumUninitialized(NumGroups);
+
+		for (int32 Group = 0; Group < NumGroups; ++Group)
+		{
+			const int32 Index = Group * 4 + 1;
+			auto CentralDelta = [Index](const TArray<float>& Stream)
+			{
+				return VectorSubtract(VectorLoad(Stream.GetData() + Index + 1), VectorLoad(Stream.GetData() + Index - 1));
+			};
+
+			const VectorRegister4Float DX = CentralDelta(Foot.X);
+			const VectorRegister4Float DY = CentralDelta(Foot.Y);
+			const VectorRegister4Float DZ = CentralDelta(Foot.Z);
+			const VectorRegister4Float DistanceSq = VectorMultiplyAdd(DX, DX, VectorMultiplyAdd(DY, DY, VectorMultiply(DZ, DZ)));
+			const VectorRegister4Float Z = VectorLoad(Foot.Z.GetData() + Index);
+
+			const VectorRegister4Float PlantMask = VectorBitwiseAnd(VectorCompareLE(Z, PlantZ), VectorCompareLE(DistanceSq, PlantDistanceSq));
+			const VectorRegister4Float LiftMask = VectorBitwiseOr(VectorCompareGT(Z, LiftZ), VectorCompareGT(DistanceSq, LiftDistanceSq));
+
+			Foot.PlantBits[Group] = static_cast<uint8>(VectorMaskBits(PlantMask));
+			Foot.LiftBits[Group] = static_cast<uint8>(VectorMaskBits(LiftMask));
+		}
+	}
+
+	/** Walk the foot's frames with hysteresis, adding an event each time it plants or lifts */
+	static void DetectContacts(const FFootSamples& Foot, int32 FootIndex, int32 NumFrames, bool bLooping,
+		TArray<FContactEvent>& OutEvents)
+	{
+		auto Step = [&Foot](int32 Frame, bool& bPlanted)
+		{
+			if (!bPlanted && Foot.CanPlant(Frame))
+			{
+				bPlanted = true;
+				return true;
+			}
+			if (bPlanted && Foot.MustLift(Frame))
+			{
+				bPlanted = false;
+				return true;
+			}
+			return false;
+		};
+
+		bool bPlanted = Foot.CanPlant(0);
+		if (bLooping)
+		{
+			// Start in the state the foot ends in
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				Step(Frame, bPlanted);
+			}
+		}
+
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			if (Step(Frame, bPlanted))
+			{
+				OutEvents.Add({ Frame, FootIndex, bPlanted });
+			}
+		}
+	}
+
+	static int32 FindOrAddNotifyTrack(UAnimSequence* Animation, FName TrackName)
+	{
+		if (!UAnimationBlueprintLibrary::IsValidAnimNotifyTrackName(Animation, TrackName))
+		{
+			UAnimationBlueprintLibrary::AddAnimationNotifyTrack(Animation, TrackName);
+		}
+		return Animation->AnimNotifyTracks.IndexOfByPredicate([TrackName](const FAnimNotifyTrack& Track)
+		{
+			return Track.TrackName == TrackName;
+		});
+	}
+
+	static void RemoveTrackContents(UAnimSequence* Animation, FName SyncMarkerTrackName, FName NotifyTrackName)
+	{
+		if (UAnimationBlueprintLibrary::IsValidAnimNotifyTrackName(Animation, SyncMarkerTrackName))
+		{
+			UAnimationBlueprintLibrary::RemoveAnimationSyncMarkersByTrack(Animation, SyncMarkerTrackName);
+		}
+		if (UAnimationBlueprintLibrary::IsValidAnimNotifyTrackName(Animation, NotifyTrackName))
+		{
+			UAnimationBlueprintLibrary::RemoveAnimationNotifyEventsByTrack(Animation, NotifyTrackName);
+		}
+	}
+}
+
+void UFootstepMarkersModifier::OnApply_Implementation(UAnimSequence* Animation)
+{
+	using namespace FootstepMarkersModifier;
+
+	SIMPLEANIM_SCOPE_CYCLE_COUNTER(FootstepMarkersModifier);
+
+	if (!Animation)
+	{
+		return;
+	}
+
+	SIMPLEANIM_SCOPE_ASSET(Animation);
+
+	const USkeleton* Skeleton = Animation->GetSkeleton();
+	if (!IsValid(Skeleton))
+	{
+		UE_LOG(LogAnimation, Error, TEXT("FootstepMarkersModifier failed. Reason: Invalid Skeleton. Animation: %s"), *GetNameSafe(Animation));
+		return;
+	}
+
+	const int32 NumFrames = Animation->GetNumberOfSampledKeys();
+	if (NumFrames < 2)
+	{
+		return;
+	}
+
+	const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
+	TArray<FFootSamples> Samples;
+	Samples.SetNum(Feet.Num());
+	const int32 NumSamples = Align(NumFrames, 4) + 2;
+	for (int32 FootIndex = 0; FootIndex < Feet.Num(); ++FootIndex)
+	{
+		FFootSamples& Foot = Samples[FootIndex];
+		Foot.BoneIndex = RefSkeleton.FindRawBoneIndex(Feet[FootIndex].FootBone.BoneName);
+		if (Foot.BoneIndex == INDEX_NONE)
+		{
+			UE_LOG(LogAnimation, Warning, TEXT("FootstepMarkersModifier skipping foot %s. Reason: Bone not found. Animation: %s"),
+				*Feet[FootIndex].FootBone.BoneName.ToString(), *GetNameSafe(Animation));
+			continue;
+		}
+		Foot.X.SetNumUninitialized(NumSamples);
+		Foot.Y.SetNumUninitialized(NumSamples);
+		Foot.Z.SetNumUninitialized(NumSamples);
+	}
+
+	const FFrameRate FrameRate = Animation->GetSamplingFrameRate();
+
+	// Feet are measured with root motion, so a planted foot is still
+	{
+		TGuardValue<bool> ForceRootLockGuard(Animation->bForceRootLock, false);
+
+		// Evaluates each frame once for every bone, shared by every worker thread
+		const FSimpleAnimPoseSampler Sampler(Animation);
+
+		// Scratch pose for each worker thread, reused for every frame that thread evaluates
+		struct FEvaluationContext
+		{
+			FSimpleAnimPoseWorkspace Workspace;
+		};
+		TArray<FEvaluationContext> EvaluationContexts;
+
+		// Frames don't depend on each other, and each frame writes only its own sample
+		const EParallelForFlags ParallelFlags = bParallelEvaluate ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+		ParallelForWithTaskContext(EvaluationContexts, NumFrames, [&](FEvaluationContext& Context, int32 Frame)
+		{
+			SIMPLEANIM_SCOPE_CYCLE_COUNTER(FootstepMarkersModifier_EvaluateFrame);
+
+			FSimpleAnimPoseWorkspace& Workspace = Context.Workspace;
+			if (!Workspace.IsInitialized())
+			{
+				Workspace.Init(RefSkeleton);
+			}
+			Workspace.SetLocalPoseFromSampler(Sampler, static_cast<float>(FrameRate.AsSeconds(Frame)));
+
+			for (FFootSamples& Foot : Samples)
+			{
+				if (Foot.BoneIndex != INDEX_NONE)
+				{
+					const FVector Location = Workspace.GetComponentTransform(Foot.BoneIndex).GetLocation();
+					Foot.X[Frame + 1] = static_cast<float>(Location.X);
+					Foot.Y[Frame + 1] = static_cast<float>(Location.Y);
+					Foot.Z[Frame + 1] = static_cast<float>(Location.Z);
+				}
+			}
+		}, ParallelFlags);
+	}
+
+	// Speeds become distances between the frames either side, which are two frames apart
+	const float CentralDeltaTime = 2.f * static_cast<float>(FrameRate.AsInterval());
+
+	TArray<FContactEvent> Events;
+	for (int32 FootIndex = 0; FootIndex < Samples.Num(); ++FootIndex)
+	{
+		FFootSamples& Foot = Samples[FootIndex];
+		if (Foot.BoneIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		PadStream(Foot.X, NumFrames);
+		PadStream(Foot.Y, NumFrames);
+		PadStream(Foot.Z, NumFrames);
+		Classify(Foot, NumFrames, PlantHeight, LiftHeight, PlantSpeed * CentralDeltaTime, LiftSpeed * CentralDeltaTime);
+		DetectContacts(Foot, FootIndex, NumFrames, bLooping, Events);
+	}
+
+	// Replace anything from a previous apply
+	RemoveTrackContents(Animation, SyncMarkerTrackName, NotifyTrackName);
+
+	// Markers and notifies aren't part of the data model, so add them all directly and refresh the animation once
+	if (bGenerateSyncMarkers)
+	{
+		const int32 TrackIndex = FindOrAddNotifyTrack(Animation, SyncMarkerTrackName);
+		for (const FContactEvent& Event : Events)
+		{
+			const FFootstepMarkerFoot& Foot = Feet[Event.FootIndex];
+			const FName MarkerName = Event.bPlant ? Foot.PlantMarkerName : Foot.LiftMarkerName;
+			if (!MarkerName.IsNone())
+			{
+				FAnimSyncMarker& Marker = Animation->AuthoredSyncMarkers.AddDefaulted_GetRef();
+				Marker.MarkerName = MarkerName;
+				Marker.Time = static_cast<float>(FrameRate.AsSeconds(Event.Frame));
+				Marker.TrackIndex = TrackIndex;
+				Marker.Guid = FGuid::NewGuid();
+			}
+		}
+		Animation->RefreshSyncMarkerDataFromAuthored();
+	}
+
+	if (bGenerateNotifies)
+	{
+		const int32 TrackIndex = FindOrAddNotifyTrack(Animation, NotifyTrackName);
+		for (const FContactEvent& Event : Events)
+		{
+			const FFootstepMarkerFoot& Foot = Feet[Event.FootIndex];
+			if (!Event.bPlant || (!Foot.PlantNotify && Foot.PlantNotifyName.IsNone()))
+			{
+				continue;
+			}
+
+			const float Time = static_cast<float>(FrameRate.AsSeconds(Event.Frame));
+			FAnimNotifyEvent& Notify = Animation->Notifies.AddDefaulted_GetRef();
+			Notify.Link(Animation, Time);
+			Notify.TriggerTimeOffset = GetTriggerTimeOffsetForType(Animation->CalculateOffsetForNotify(Time));
+			Notify.TrackIndex = TrackIndex;
+			Notify.Guid = FGuid::NewGuid();
+
+			if (Foot.PlantNotify)
+			{
+				Notify.Notify = NewObject<UAnimNotify>(Animation, Foot.PlantNotify, NAME_None, RF_Transactional);
+				Notify.NotifyName = FName(*Notify.Notify->GetNotifyName());
+			}
+			else
+			{
+				Notify.NotifyName = Foot.PlantNotifyName;
+			}
+		}
+		Animation->SortNotifies();
+	}
+
+	Animation->RefreshCacheData();
+}
+
+void UFootstepMarkersModifier::OnRevert_Implementation(UAnimSequence* Animation)
+{
+	if (Animation)
+	{
+		FootstepMarkersModifier::RemoveTrackContents(Animation, SyncMarkerTrackName, NotifyTrackName);
+	}
+}
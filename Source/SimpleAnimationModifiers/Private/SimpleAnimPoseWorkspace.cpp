@@ -0,0 +1,179 @@
+﻿// Copyright (c) Jared Taylor.
+
+
+#include "SimpleAnimPoseWorkspace.h"
+
+#include "SimpleAnimPoseSampler.h"
+#include "ReferenceSkeleton.h"
+
+void FSimpleAnimPoseWorkspace::Init(const FReferenceSkeleton& RefSkeleton)
+{
+	const int32 NumBones = RefSkeleton.GetRawBoneNum();
+
+	BoneNames.Reset(NumBones);
+	ParentIndices.Reset(NumBones);
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		BoneNames.Add(RefSkeleton.GetBoneName(BoneIndex));
+		ParentIndices.Add(RefSkeleton.GetParentIndex(BoneIndex));
+	}
+
+	// Flatten the children of each bone, so marking a subtree dirty only visits that subtree
+	ChildOffsets.Init(0, NumBones + 1);
+	for (const int32 ParentIndex : ParentIndices)
+	{
+		if (ParentIndex != INDEX_NONE)
+		{
+			++ChildOffsets[ParentIndex + 1];
+		}
+	}
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		ChildOffsets[BoneIndex + 1] += ChildOffsets[BoneIndex];
+	}
+
+	Children.SetNumUninitialized(ChildOffsets[NumBones]);
+	TArray<int32> NumChildrenAdded;
+	NumChildrenAdded.Init(0, NumBones);
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		const int32 ParentIndex = ParentIndices[BoneIndex];
+		if (ParentIndex != INDEX_NONE)
+		{
+			Children[ChildOffsets[ParentIndex] + NumChildrenAdded[ParentIndex]++] = BoneIndex;
+		}
+	}
+
+	ComponentTransforms.SetNum(NumBones);
+	WorldTransforms.SetNum(NumBones);
+	SetLocalPose(RefSkeleton.GetRawRefBonePose());
+}
+
+bool FSimpleAnimPoseWorkspace::SetLocalPoseFromSampler(const FSimpleAnimPoseSampler& Sampler, float Time)
+{
+	if (!IsInitialized() || !Sampler.IsValid() || Sampler.GetNumBones() != GetNumBones())
+	{
+		return false;
+	}
+
+	// The sampler evaluates the whole pose once, and already has every raw bone in the same order
+	Sampler.SampleLocal(Time, LocalTransforms);
+	MarkAllDirty();
+	return true;
+}
+
+void FSimpleAnimPoseWorkspace::SetLocalPose(TConstArrayView<FTransform> InLocalTransforms)
+{
+	check(InLocalTransforms.Num() == ParentIndices.Num());
+	LocalTransforms.Reset(InLocalTransforms.Num());
+	LocalTransforms.Append(InLocalTransforms.GetData(), InLocalTransforms.Num());
+	MarkAllDirty();
+}
+
+void FSimpleAnimPoseWorkspace::SetComponentToWorld(const FTransform& InComponentToWorld)
+{
+	ComponentToWorld = InComponentToWorld;
+	MarkAllDirty();
+}
+
+const FTransform& FSimpleAnimPoseWorkspace::GetComponentTransform(int32 BoneIndex)
+{
+	Resolve(BoneIndex);
+	return ComponentTransforms[BoneIndex];
+}
+
+const FTransform& FSimpleAnimPoseWorkspace::GetWorldTransform(int32 BoneIndex)
+{
+	Resolve(BoneIndex);
+	return WorldTransforms[BoneIndex];
+}
+
+const FTransform& FSimpleAnimPoseWorkspace::GetTransform(int32 BoneIndex, EAnimPoseSpaces Space)
+{
+	return Space == EAnimPoseSpaces::Local ? GetLocalTransform(BoneIndex) : GetWorldTransform(BoneIndex);
+}
+
+void FSimpleAnimPoseWorkspace::SetLocalTransform(int32 BoneIndex, const FTransform& Transform)
+{
+	LocalTransforms[BoneIndex] = Transform;
+	MarkSubtreeDirty(BoneIndex);
+}
+
+void FSimpleAnimPoseWorkspace::SetComponentTransform(int32 BoneIndex, const FTransform& Transform)
+{
+	const int32 ParentIndex = ParentIndices[BoneIndex];
+	const FTransform& ParentTransform = ParentIndex != INDEX_NONE ? GetComponentTransform(ParentIndex) : FTransform::Identity;
+	SetLocalTransform(BoneIndex, Transform.GetRelativeTransform(ParentTransform));
+}
+
+void FSimpleAnimPoseWorkspace::SetWorldTransform(int32 BoneIndex, const FTransform& Transform)
+{
+	const int32 ParentIndex = ParentIndices[BoneIndex];
+	const FTransform& ParentTransform = ParentIndex != INDEX_NONE ? GetWorldTransform(ParentIndex) : ComponentToWorld;
+	SetLocalTransform(BoneIndex, Transform.GetRelativeTransform(ParentTransform));
+}
+
+void FSimpleAnimPoseWorkspace::SetTransform(int32 BoneIndex, const FTransform& Transform, EAnimPoseSpaces Space)
+{
+	if (Space == EAnimPoseSpaces::Local)
+	{
+		SetLocalTransform(BoneIndex, Transform);
+	}
+	else
+	{
+		SetWorldTransform(BoneIndex, Transform);
+	}
+}
+
+void FSimpleAnimPoseWorkspace::Resolve(int32 BoneIndex)
+{
+	if (!DirtyBones[BoneIndex])
+	{
+		return;
+	}
+
+	// Walk up to the first clean parent, then back down, parents of a clean bone are always clean
+	TArray<int32, TInlineAllocator<32>> Chain;
+	for (int32 ChainIndex = BoneIndex; ChainIndex != INDEX_NONE && DirtyBones[ChainIndex]; ChainIndex = ParentIndices[ChainIndex])
+	{
+		Chain.Add(ChainIndex);
+	}
+
+	for (int32 Index = Chain.Num() - 1; Index >= 0; --Index)
+	{
+		const int32 ChainIndex = Chain[Index];
+		const int32 ParentIndex = ParentIndices[ChainIndex];
+		ComponentTransforms[ChainIndex] = ParentIndex != INDEX_NONE
+			? LocalTransforms[ChainIndex] * ComponentTransforms[ParentIndex]
+			: LocalTransforms[ChainIndex];
+		WorldTransforms[ChainIndex] = ComponentTransforms[ChainIndex] * ComponentToWorld;
+		DirtyBones[ChainIndex] = false;
+	}
+}
+
+void FSimpleAnimPoseWorkspace::MarkSubtreeDirty(int32 BoneIndex)
+{
+	DirtyBones[BoneIndex] = true;
+
+	TArray<int32, TInlineAllocator<32>> Pending;
+	Pending.Add(BoneIndex);
+	for (int32 PendingIndex = 0; PendingIndex < Pending.Num(); ++PendingIndex)
+	{
+		const int32 ParentIndex = Pending[PendingIndex];
+		for (int32 ChildIndex = ChildOffsets[ParentIndex]; ChildIndex < ChildOffsets[ParentIndex + 1]; ++ChildIndex)
+		{
+			// Everything under a dirty bone is already dirty
+			const int32 Child = Children[ChildIndex];
+			if (!DirtyBones[Child])
+			{
+				DirtyBones[Child] = true;
+				Pending.Add(Child);
+			}
+		}
+	}
+}
+
+void FSimpleAnimPoseWorkspace::MarkAllDirty()
+{
+	DirtyBones.Init(true, LocalTransforms.Num());
+}
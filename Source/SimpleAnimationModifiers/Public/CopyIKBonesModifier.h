@@ -39,6 +39,15 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
 	EAnimPoseSpaces BonePoseSpace = EAnimPoseSpaces::World;
+
+	/**
+	 * Evaluate frames across worker threads, through FSimpleAnimPoseSampler which only reads the animation's raw data
+	 * Off by default, the engine doesn't document evaluating raw data off the game thread as safe, so nothing else may
+	 * edit the animation while the modifier runs
+	 * Keys are still written on the game thread in a single bracket once every frame is evaluated
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	bool bParallelEvaluate = false;
 	
 public:
 	UCopyIKBonesModifier()
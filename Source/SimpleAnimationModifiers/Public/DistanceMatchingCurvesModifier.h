@@ -0,0 +1,79 @@
+﻿// Copyright (c) Jared Taylor.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Editor/AnimationModifiers/Public/AnimationModifier.h"
+#include "DistanceMatchingCurvesModifier.generated.h"
+
+/**
+ * Bakes root motion distance, speed and yaw rate curves for distance matching
+ * Every frame is evaluated once, then each curve is keyed, reduced to its own tolerance, and written in a single
+ * data controller bracket
+ * Warns if the animation travels on the pelvis instead of the root, because the curves would then be flat
+ * Curves sharing a name are baked once, for the first of distance, speed and yaw rate
+ */
+UCLASS(DisplayName = "Distance Matching Curves Modifier")
+class SIMPLEANIMATIONMODIFIERS_API UDistanceMatchingCurvesModifier : public UAnimationModifier
+{
+	GENERATED_BODY()
+
+public:
+	/** Root distance curve, none to skip */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	FName DistanceCurveName = TEXT("Distance");
+
+	/** Root speed curve in cm/s, none to skip */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	FName SpeedCurveName = TEXT("Speed");
+
+	/** Root yaw rate curve in degrees/s, none to skip */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	FName YawRateCurveName = TEXT("YawRate");
+
+	/**
+	 * Distance remaining until the end of the animation, negative and reaching 0 on the last frame, e.g. for stops
+	 * Otherwise the distance traveled since the first frame, e.g. for starts
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	bool bDistanceToEnd = false;
+
+	/** Measure distance and speed along the ground only */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	bool bIgnoreZ = true;
+
+	/** Remove keys while keeping the distance curve within this of its value on every frame, 0 to key every frame */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings", meta=(ClampMin="0", ForceUnits="cm"))
+	float DistanceTolerance = 0.1f;
+
+	/** Remove keys while keeping the speed curve within this of its value on every frame, 0 to key every frame */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings", meta=(ClampMin="0", ForceUnits="cm/s"))
+	float SpeedTolerance = 1.f;
+
+	/** Remove keys while keeping the yaw rate curve within this of its value on every frame, 0 to key every frame */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings", meta=(ClampMin="0", ForceUnits="deg/s"))
+	float YawRateTolerance = 1.f;
+
+	/** Add the curves as metadata curves */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	bool bMetaDataCurves = false;
+
+	/** Bone checked for motion that should be on the root, none to skip the check */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	FName PelvisBoneName = TEXT("pelvis");
+
+	/** Warn if the root travels less than this while the pelvis travels further than this */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings", meta=(ClampMin="0", ForceUnits="cm"))
+	float PelvisMotionThreshold = 10.f;
+
+	/** Evaluate frames across worker threads, see UCopyIKBonesModifier::bParallelEvaluate */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	bool bParallelEvaluate = false;
+
+public:
+	virtual void OnApply_Implementation(UAnimSequence* Animation) override;
+	virtual void OnRevert_Implementation(UAnimSequence* Animation) override;
+
+protected:
+	TArray<FName> GetCurveNames() const;
+};
@@ -0,0 +1,112 @@
+﻿// Copyright (c) Jared Taylor.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BoneContainer.h"
+#include "Editor/AnimationModifiers/Public/AnimationModifier.h"
+#include "FootstepMarkersModifier.generated.h"
+
+class UAnimNotify;
+
+USTRUCT(BlueprintType)
+struct FFootstepMarkerFoot
+{
+	GENERATED_BODY()
+
+	FFootstepMarkerFoot(const FName& InFootBone = NAME_None, const FName& InPlantMarkerName = NAME_None,
+		const FName& InPlantNotifyName = NAME_None)
+		: FootBone(InFootBone), PlantMarkerName(InPlantMarkerName), PlantNotifyName(InPlantNotifyName)
+	{}
+
+	/** Bone to detect contacts for, usually the foot or the ball */
+	UPROPERTY(EditAnywhere, Category="Settings")
+	FBoneReference FootBone;
+
+	/** Sync marker added when the foot plants, none for no marker */
+	UPROPERTY(EditAnywhere, Category="Settings")
+	FName PlantMarkerName;
+
+	/** Sync marker added when the foot lifts, none to only mark plants */
+	UPROPERTY(EditAnywhere, Category="Settings")
+	FName LiftMarkerName;
+
+	/** Skeleton notify added when the foot plants if there is no PlantNotify, none for no notify */
+	UPROPERTY(EditAnywhere, Category="Settings")
+	FName PlantNotifyName;
+
+	/** Notify added when the foot plants, instead of PlantNotifyName */
+	UPROPERTY(EditAnywhere, Category="Settings")
+	TSubclassOf<UAnimNotify> PlantNotify;
+};
+
+/**
+ * Adds sync markers and notifies where each foot plants and lifts
+ * Every frame is evaluated once, then contacts are classified 4 frames at a time from the foot heights and speeds
+ * A foot plants once it is both low and slow, and lifts once it is either high or fast, the gap between the two stops
+ * noisy contacts from being marked twice
+ */
+UCLASS(DisplayName = "Footstep Markers Modifier")
+class SIMPLEANIMATIONMODIFIERS_API UFootstepMarkersModifier : public UAnimationModifier
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	TArray<FFootstepMarkerFoot> Feet;
+
+	/** Height above the foot's lowest point in the animation, below which the foot can plant */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings", meta=(ClampMin="0", ForceUnits="cm"))
+	float PlantHeight = 5.f;
+
+	/** Height above the foot's lowest point in the animation, above which the foot lifts, should be more than PlantHeight */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings", meta=(ClampMin="0", ForceUnits="cm"))
+	float LiftHeight = 10.f;
+
+	/**
+	 * Speed below which the foot can plant
+	 * Measured with root motion, so a planted foot is still, but in an in place animation it slides at the movement speed
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings", meta=(ClampMin="0", ForceUnits="cm/s"))
+	float PlantSpeed = 25.f;
+
+	/** Speed above which the foot lifts, should be more than PlantSpeed */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings", meta=(ClampMin="0", ForceUnits="cm/s"))
+	float LiftSpeed = 75.f;
+
+	/**
+	 * Start each foot in the state it ends the animation in, so a contact on the first frame is only marked if the foot
+	 * was lifted on the last frame
+	 * Otherwise a foot that is already planted on the first frame is not marked
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	bool bLooping = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	bool bGenerateSyncMarkers = true;
+
+	/** Existing markers on this track are replaced */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings", meta=(EditCondition="bGenerateSyncMarkers"))
+	FName SyncMarkerTrackName = TEXT("FootSyncMarkers");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	bool bGenerateNotifies = true;
+
+	/** Existing notifies on this track are replaced */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings", meta=(EditCondition="bGenerateNotifies"))
+	FName NotifyTrackName = TEXT("FootstepNotifies");
+
+	/** Evaluate frames across worker threads, see UCopyIKBonesModifier::bParallelEvaluate */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Settings")
+	bool bParallelEvaluate = false;
+
+public:
+	UFootstepMarkersModifier()
+		: Feet( {
+			{ "foot_l", "Foot_L", "Footstep_L" },
+			{ "foot_r", "Foot_R", "Footstep_R" } } )
+	{}
+
+	virtual void OnApply_Implementation(UAnimSequence* Animation) override;
+	virtual void OnRevert_Implementation(UAnimSequence* Animation) override;
+};
@@ -0,0 +1,85 @@
+﻿// Copyright (c) Jared Taylor.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AnimPose.h"
+
+struct FReferenceSkeleton;
+struct FSimpleAnimPoseSampler;
+
+/**
+ * Local, component and world transforms of every raw bone in flat arrays, in reference skeleton (parent first) order
+ * Bone indices are raw bone indices, the same as FSimpleAnimPoseSampler, virtual bones aren't included
+ * Editing a bone only marks its subtree dirty, and component and world transforms are only recomputed for the bones
+ * that are read, so converting a few bones between spaces walks their parent chains instead of the whole skeleton
+ * World space matches FAnimPose, i.e. component space unless SetComponentToWorld() is used
+ * Not thread safe, use one workspace per thread
+ */
+struct SIMPLEANIMATIONMODIFIERS_API FSimpleAnimPoseWorkspace
+{
+	/** Size for the skeleton's raw bones, every bone is set to its reference pose */
+	void Init(const FReferenceSkeleton& RefSkeleton);
+
+	bool IsInitialized() const { return LocalTransforms.Num() > 0; }
+	int32 GetNumBones() const { return LocalTransforms.Num(); }
+	const TArray<FName>& GetBoneNames() const { return BoneNames; }
+	int32 GetParentIndex(int32 BoneIndex) const { return ParentIndices[BoneIndex]; }
+
+	/**
+	 * Evaluate the sampler's animation once at Time, straight into the local transforms
+	 * @return False if the sampler is invalid or for a different skeleton, the workspace is then unchanged
+	 */
+	bool SetLocalPoseFromSampler(const FSimpleAnimPoseSampler& Sampler, float Time);
+
+	/** Replace every local transform, in the same order as the skeleton */
+	void SetLocalPose(TConstArrayView<FTransform> InLocalTransforms);
+
+	/** Transform applied on top of component space to get world space, identity by default */
+	void SetComponentToWorld(const FTransform& InComponentToWorld);
+	const FTransform& GetComponentToWorld() const { return ComponentToWorld; }
+
+	const FTransform& GetLocalTransform(int32 BoneIndex) const { return LocalTransforms[BoneIndex]; }
+	const FTransform& GetComponentTransform(int32 BoneIndex);
+	const FTransform& GetWorldTransform(int32 BoneIndex);
+
+	/** World is world space as FAnimPose uses it, which is component space unless SetComponentToWorld() is used */
+	const FTransform& GetTransform(int32 BoneIndex, EAnimPoseSpaces Space);
+
+	/** Set the bone's local transform, and mark its subtree dirty */
+	void SetLocalTransform(int32 BoneIndex, const FTransform& Transform);
+
+	/** Set the bone's local transform so it ends up at this component transform, and mark its subtree dirty */
+	void SetComponentTransform(int32 BoneIndex, const FTransform& Transform);
+
+	/** Set the bone's local transform so it ends up at this world transform, and mark its subtree dirty */
+	void SetWorldTransform(int32 BoneIndex, const FTransform& Transform);
+
+	void SetTransform(int32 BoneIndex, const FTransform& Transform, EAnimPoseSpaces Space);
+
+protected:
+	/** Recompute the component and world transforms of the bone and any dirty parents */
+	void Resolve(int32 BoneIndex);
+
+	/** Mark the bone and every bone under it as needing their component and world transforms recomputed */
+	void MarkSubtreeDirty(int32 BoneIndex);
+
+	void MarkAllDirty();
+
+protected:
+	TArray<FName> BoneNames;
+	TArray<int32> ParentIndices;
+
+	/** Children of bone i are Children[ChildOffsets[i]] to Children[ChildOffsets[i + 1] - 1] */
+	TArray<int32> ChildOffsets;
+	TArray<int32> Children;
+
+	TArray<FTransform> LocalTransforms;
+	TArray<FTransform> ComponentTransforms;
+	TArray<FTransform> WorldTransforms;
+
+	/** Bones whose component and world transforms are stale, if a bone is dirty so is every bone under it */
+	TBitArray<> DirtyBones;
+
+	FTransform ComponentToWorld = FTransform::Identity;
+};
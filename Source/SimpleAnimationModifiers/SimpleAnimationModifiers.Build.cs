@@ -20,6 +20,7 @@ public class SimpleAnimationModifiers : ModuleRules
             {
                 "CoreUObject",
                 "Engine",
+                "SimpleAnimation",
             }
         );
     }